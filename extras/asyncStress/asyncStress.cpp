@@ -0,0 +1,97 @@
+/**
+ * stress test of the rows written by other threads (src/uAsyncRows.h)
+ *
+ * Every producer owns a span of a row and writes it with one repeated
+ * character, the next write uses the next character. The consumer plays the
+ * display thread and checks that no span ever mixes two writes.
+ *
+ * build:
+ *	g++ -std=c++11 -O2 -pthread -I../../src -I<path to SDDS>/src asyncStress.cpp -o asyncStress
+ *
+ * usage:
+ *	asyncStress [producers] [seconds]
+ */
+
+#include "uAsyncRows.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace sdds::textDisplaySpike;
+
+namespace {
+	constexpr int N_ROWS = 4;
+	constexpr int N_COLUMNS = 20;
+	constexpr int SPAN = 5;		//4 producers per row
+
+	typedef TasyncRows<N_ROWS,N_COLUMNS> Trows;
+}
+
+int main(int argc, char** argv){
+	int producers = argc > 1 ? atoi(argv[1]) : 4;
+	int seconds = argc > 2 ? atoi(argv[2]) : 2;
+	if (producers < 1 || producers > N_ROWS*N_COLUMNS/SPAN){
+		fprintf(stderr,"1..%d producers\n",N_ROWS*N_COLUMNS/SPAN);
+		return 1;
+	}
+
+	Trows rows;
+	std::atomic<bool> stop{false};
+	std::vector<unsigned long> writes(producers);
+	std::vector<std::thread> threads;
+
+	for (auto p = 0; p < producers; p++){
+		threads.emplace_back([&,p](){
+			//spread the producers over the rows first, so they rarely share a lock
+			int row = p % N_ROWS;
+			int col = (p / N_ROWS) * SPAN;
+			char text[SPAN+1] = {};
+			unsigned long n = 0;
+			while (!stop.load(std::memory_order_relaxed)){
+				for (auto i = 0; i < SPAN; i++) text[i] = 'A' + n % 26;
+				rows.write(row,col,text,SPAN);
+				n++;
+			}
+			writes[p] = n;
+		});
+	}
+
+	unsigned long reads = 0;
+	unsigned long torn = 0;
+	auto begin = std::chrono::steady_clock::now();
+	auto end = begin + std::chrono::seconds(seconds);
+	while (std::chrono::steady_clock::now() < end){
+		auto pending = rows.takePending();
+		for (auto row = 0; row < N_ROWS; row++){
+			if (!(pending & (1u << row))) continue;
+			dtypes::int16 text[N_COLUMNS];
+			int first, last;
+			if (!rows.read(row,text,first,last)) continue;
+			reads++;
+			for (auto col = first; col + SPAN - 1 <= last; col += SPAN){
+				if (text[col] == Trows::UNUSED) continue;
+				for (auto i = 1; i < SPAN; i++)
+					if (text[col+i] != text[col]){
+						torn++;
+						break;
+					}
+			}
+		}
+		//the display thread has other work too
+		std::this_thread::yield();
+	}
+	stop = true;
+	for (auto& t : threads) t.join();
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	unsigned long totalWrites = 0;
+	for (auto w : writes) totalWrites += w;
+	printf("%d producers, %.1f s\n",producers,elapsed);
+	printf("writes %.2f M/s, row reads %.0f /s, given up %u\n",totalWrites/elapsed/1e6,reads/elapsed,rows.retries());
+	printf("torn spans %lu\n",torn);
+	return torn == 0 ? 0 : 2;
+}
@@ -0,0 +1,295 @@
+/**
+ * terminal viewer for TremoteDisplay (src/uRemoteDisplay.h)
+ *
+ * build:
+ *	g++ -std=c++11 -O2 -I../../src -I<path to SDDS>/src remoteViewer.cpp -o remoteViewer
+ *
+ * usage:
+ *	remoteViewer /dev/ttyUSB0 [baudrate]	serial port, default 115200
+ *	remoteViewer host:port					tcp, e.g. a serial to network bridge
+ *
+ * keys: arrows, enter, esc (or backspace), q quits
+ */
+
+#include "uRemoteProtocol.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace sdds::textDisplaySpike;
+
+namespace {
+	constexpr int MAX_ROWS = 16;
+	constexpr int MAX_COLUMNS = 80;
+
+	//key codes of TremoteDisplay
+	constexpr dtypes::uint8 KEY_LEFT = 75;
+	constexpr dtypes::uint8 KEY_RIGHT = 77;
+	constexpr dtypes::uint8 KEY_UP = 72;
+	constexpr dtypes::uint8 KEY_DOWN = 80;
+	constexpr dtypes::uint8 KEY_ESC = 27;
+	constexpr dtypes::uint8 KEY_ENTER = 13;
+
+	struct Tscreen{
+		int rows = 0;
+		int columns = 0;
+		dtypes::uint8 text[MAX_ROWS][MAX_COLUMNS];
+		dtypes::uint8 glyphs[8][8] = {};
+		int cursorX = 0;
+		int cursorY = 0;
+		bool synced = false;
+
+		void clear(){
+			memset(text,' ',sizeof(text));
+		}
+	};
+
+	struct termios FoldTermios;
+
+	void restoreTerminal(){
+		tcsetattr(STDIN_FILENO,TCSANOW,&FoldTermios);
+		printf("\x1b[?25h\n");
+		fflush(stdout);
+	}
+
+	void rawTerminal(){
+		tcgetattr(STDIN_FILENO,&FoldTermios);
+		atexit(restoreTerminal);
+		struct termios t = FoldTermios;
+		cfmakeraw(&t);
+		tcsetattr(STDIN_FILENO,TCSANOW,&t);
+	}
+
+	speed_t baudrate(int _baud){
+		switch (_baud){
+			case 9600: return B9600;
+			case 19200: return B19200;
+			case 38400: return B38400;
+			case 57600: return B57600;
+			case 230400: return B230400;
+			case 460800: return B460800;
+			case 921600: return B921600;
+			default: return B115200;
+		}
+	}
+
+	int openLink(const char* _target, int _baud){
+		std::string target = _target;
+		auto colon = target.rfind(':');
+		if (target[0] != '/' && colon != std::string::npos){
+			struct addrinfo hints = {};
+			struct addrinfo* res = nullptr;
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			if (getaddrinfo(target.substr(0,colon).c_str(),target.substr(colon+1).c_str(),&hints,&res) != 0) return -1;
+			int fd = -1;
+			for (auto r = res; r; r = r->ai_next){
+				fd = socket(r->ai_family,r->ai_socktype,r->ai_protocol);
+				if (fd >= 0 && connect(fd,r->ai_addr,r->ai_addrlen) == 0) break;
+				if (fd >= 0) close(fd);
+				fd = -1;
+			}
+			freeaddrinfo(res);
+			return fd;
+		}
+
+		int fd = open(_target,O_RDWR | O_NOCTTY);
+		if (fd < 0) return -1;
+		struct termios t;
+		if (tcgetattr(fd,&t) == 0){
+			cfmakeraw(&t);
+			cfsetspeed(&t,baudrate(_baud));
+			tcsetattr(fd,TCSANOW,&t);
+		}
+		return fd;
+	}
+
+	void send(int _fd, dtypes::uint8 _type, const dtypes::uint8* _payload, int _len){
+		static dtypes::uint8 seq = 0;
+		dtypes::uint8 buf[TremoteMsg::OVERHEAD + 8];
+		auto n = remoteFrame(buf,_type,seq++,_payload,_len);
+		if (write(_fd,buf,n) != n) perror("write");
+	}
+
+	/**
+	 * @brief terminal representation of a character of the display
+	 *
+	 * Glyphs are shown as block of the width of their filled columns, that
+	 * fits the bar graphs. Text is Latin-1.
+	 */
+	std::string toTerminal(const Tscreen& _screen, dtypes::uint8 _c){
+		static const char* blocks[] = {" ","▎","▌","▋","▉","█"};
+		if (_c >= TremoteMsg::GLYPH_BASE && _c < TremoteMsg::GLYPH_BASE + 8){
+			dtypes::uint8 bits = 0;
+			for (auto row : _screen.glyphs[_c - TremoteMsg::GLYPH_BASE])
+				bits |= row;
+			int n = 0;
+			while (bits & 0x10){
+				n++;
+				bits <<= 1;
+			}
+			return blocks[n];
+		}
+		if (_c < 0x20 || (_c >= 0x7F && _c < 0xA0)) return "?";
+		if (_c < 0x80) return std::string(1,char(_c));
+		std::string utf8;
+		utf8 += char(0xC0 | (_c >> 6));
+		utf8 += char(0x80 | (_c & 0x3F));
+		return utf8;
+	}
+
+	void render(const Tscreen& _screen, dtypes::uint32 _errors){
+		std::string out = "\x1b[H\x1b[?25l";
+		std::string border = "+" + std::string(_screen.columns,'-') + "+\r\n";
+		out += border;
+		for (auto row = 0; row < _screen.rows; row++){
+			out += "|";
+			for (auto col = 0; col < _screen.columns; col++)
+				out += toTerminal(_screen,_screen.text[row][col]);
+			out += "|\r\n";
+		}
+		out += border;
+		out += _screen.synced ? "connected" : "waiting for display";
+		out += ", frame errors " + std::to_string(_errors) + "   \r\n";
+		out += "arrows, enter, esc/backspace, q quits\x1b[K";
+		out += "\x1b[" + std::to_string(_screen.cursorY + 2) + ";" + std::to_string(_screen.cursorX + 2) + "H\x1b[?25h";
+		fputs(out.c_str(),stdout);
+		fflush(stdout);
+	}
+
+	void handleFrame(Tscreen& _screen, TremoteParser<>& _parser){
+		auto p = _parser.payload();
+		auto len = _parser.len();
+		switch (_parser.type()){
+			case TremoteMsg::RESET:
+				if (len < 2) return;
+				_screen.rows = p[0] < MAX_ROWS ? p[0] : MAX_ROWS;
+				_screen.columns = p[1] < MAX_COLUMNS ? p[1] : MAX_COLUMNS;
+				_screen.synced = true;
+				_screen.clear();
+				printf("\x1b[2J");
+				return;
+			case TremoteMsg::CLEAR:
+				_screen.clear();
+				_screen.cursorX = 0;
+				_screen.cursorY = 0;
+				return;
+			case TremoteMsg::CURSOR:
+				if (len < 2) return;
+				_screen.cursorX = p[0];
+				_screen.cursorY = p[1];
+				return;
+			case TremoteMsg::ROW:{
+				if (len < 2 || p[0] >= _screen.rows || p[1] >= _screen.columns) return;
+				remoteRleDecode(&p[2],len-2,&_screen.text[p[0]][p[1]],_screen.columns-p[1]);
+				return;
+			}
+			case TremoteMsg::GLYPH:
+				if (len < 9 || p[0] >= 8) return;
+				memcpy(_screen.glyphs[p[0]],&p[1],8);
+				return;
+		}
+	}
+
+	/**
+	 * @return false to quit
+	 */
+	bool handleKeys(int _link, const char* _buf, int _n){
+		for (auto i = 0; i < _n; i++){
+			dtypes::uint8 key = 0;
+			if (_buf[i] == 'q' || _buf[i] == 3) return false;
+			if (_buf[i] == '\r' || _buf[i] == '\n') key = KEY_ENTER;
+			else if (_buf[i] == 0x7F || _buf[i] == 0x08) key = KEY_ESC;
+			else if (_buf[i] == 0x1B){
+				if (i + 2 < _n && _buf[i+1] == '['){
+					switch (_buf[i+2]){
+						case 'A': key = KEY_UP; break;
+						case 'B': key = KEY_DOWN; break;
+						case 'C': key = KEY_RIGHT; break;
+						case 'D': key = KEY_LEFT; break;
+					}
+					i += 2;
+				}
+				else key = KEY_ESC;
+			}
+			if (key) send(_link,TremoteMsg::KEY,&key,1);
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv){
+	if (argc < 2){
+		fprintf(stderr,"usage: %s <serial device> [baudrate] | <host:port>\n",argv[0]);
+		return 1;
+	}
+	int link = openLink(argv[1],argc > 2 ? atoi(argv[2]) : 115200);
+	if (link < 0){
+		perror(argv[1]);
+		return 1;
+	}
+
+	rawTerminal();
+	printf("\x1b[2J");
+
+	Tscreen screen;
+	screen.rows = 4;
+	screen.columns = 20;
+	screen.clear();
+	TremoteParser<> parser;
+	int expectedSeq = -1;
+
+	time_t lastHello = 0;
+	render(screen,0);
+
+	while (true){
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(STDIN_FILENO,&fds);
+		FD_SET(link,&fds);
+		struct timeval timeout = {0,200000};
+		int res = select(link + 1,&fds,nullptr,nullptr,&timeout);
+		if (res < 0) break;
+
+		//say hello until the display answers
+		if (!screen.synced && time(nullptr) != lastHello){
+			lastHello = time(nullptr);
+			send(link,TremoteMsg::HELLO,nullptr,0);
+		}
+
+		if (FD_ISSET(STDIN_FILENO,&fds)){
+			char buf[32];
+			int n = read(STDIN_FILENO,buf,sizeof(buf));
+			if (n <= 0 || !handleKeys(link,buf,n)) break;
+		}
+
+		if (FD_ISSET(link,&fds)){
+			dtypes::uint8 buf[256];
+			int n = read(link,buf,sizeof(buf));
+			if (n <= 0) break;
+			for (auto i = 0; i < n; i++){
+				if (!parser.push(buf[i])) continue;
+				bool reset = parser.type() == TremoteMsg::RESET;
+				if (!reset && (!screen.synced || parser.seq() != dtypes::uint8(expectedSeq))){
+					//lost something, hello again for a full frame
+					screen.synced = false;
+					expectedSeq = -1;
+					continue;
+				}
+				expectedSeq = parser.seq() + 1;
+				handleFrame(screen,parser);
+			}
+			render(screen,parser.errors());
+		}
+	}
+	return 0;
+}
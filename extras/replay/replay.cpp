@@ -0,0 +1,74 @@
+/**
+ * replays a recording of Trecorder (src/uRecorder.h) on the host
+ *
+ * The menu tree below has to be the one of the recorded application,
+ * replace it with your own TuserStruct.
+ *
+ * build:
+ *	g++ -std=c++11 -O2 -I../../src -I<path to SDDS>/src replay.cpp -o replay
+ *
+ * usage:
+ *	replay session.tdsr [settle time in ms]
+ *
+ * exit code 0 if the output matches the recording, 2 if not
+ */
+
+#include "uTypedef.h"
+#include "uMultask.h"
+#include "uTextDisplaySpike.h"
+#include "uRecorder.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace sdds::textDisplaySpike;
+
+sdds_enum(OFF,ON) TonOffState;
+
+class Tled : public TmenuHandle{
+	public:
+		sdds_struct(
+			sdds_var(TonOffState,ledSwitch)
+			sdds_var(TonOffState,blinkSwitch)
+			sdds_var(Tuint16,onTime)
+			sdds_var(Tuint16,offTime)
+		)
+};
+
+class TuserStruct : public TmenuHandle{
+	public:
+		sdds_struct(
+			sdds_var(Tled,led)
+		)
+} userStruct;
+
+typedef TreplayDisplay<4,20,TfileSource> Treplay;
+
+int main(int argc, char** argv){
+	if (argc < 2){
+		fprintf(stderr,"usage: %s <recording> [settle time in ms]\n",argv[0]);
+		return 1;
+	}
+	FILE* file = fopen(argv[1],"rb");
+	if (!file){
+		perror(argv[1]);
+		return 1;
+	}
+
+	TfileSource source(file);
+	Treplay disp(&source);
+	if (disp.done()){
+		fprintf(stderr,"%s: no recording of a 4x20 display\n",argv[1]);
+		return 1;
+	}
+	if (argc > 2) disp.setSettleTime(atoi(argv[2]));
+	TtextDisplaySpike<Treplay> tds(userStruct,disp);
+	tds.setKeyPollInterval(1);
+
+	while (!disp.done())
+		TtaskHandler::handleEvents();
+
+	disp.report(stdout);
+	fclose(file);
+	return disp.statistic().mismatches == 0 ? 0 : 2;
+}
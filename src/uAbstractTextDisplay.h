@@ -1,6 +1,13 @@
 #ifndef UABSTRACTTEXTDISPLAY_H
 #define UABSTRACTTEXTDISPLAY_H
 
+#include "uTdsConfig.h"
+#include "uTdsMillis.h"
+#include "uTextOverlay.h"
+#include "uGlyphCache.h"
+#include "uCharset.h"
+#include "uAsyncRows.h"
+
 namespace sdds{
 	namespace textDisplaySpike{
 
@@ -11,20 +18,37 @@ namespace sdds{
 			const char* operator[](int row) const { return Fbuffer[row]; }
 		};
 
+		/**
+		 * @brief order in which pending rows are transmitted
+		 *
+		 * The row of the cursor is always FOCUS, other rows are VALUE unless
+		 * the application lowers them with setRowPriority.
+		 */
+		struct TrowPriority{
+			constexpr static dtypes::uint8 FOCUS		= 0;	//row the user is working on
+			constexpr static dtypes::uint8 VALUE		= 1;	//user visible value changes
+			constexpr static dtypes::uint8 BACKGROUND	= 2;	//refresh that can wait
+		};
+
+		struct TcursorInterface{
+			int x=0;
+			int y=0;
+		};
+
 		struct TrowChanges{
 			const char* _buffer = nullptr;
 			int row;
 			int firstChangedIdx;
 			int lastChangedIdx;
 			int n = 0;
+			//false if the address counter of the display already points to firstChangedIdx
+			bool setPosition = true;
+			//set the cursor to 'cursor' after the text within the same transaction
+			bool restoreCursor = false;
+			TcursorInterface cursor;
 			bool hasChanges(){ return _buffer != nullptr; }
 		};
 
-		struct TcursorInterface{
-			int x=0;
-			int y=0;
-		};
-
 		template <int nRows, int nColumns>
 		struct Tcursor : public TcursorInterface{
 			public:
@@ -34,6 +58,89 @@ namespace sdds{
 				void down(){ y++; }
 		};
 
+		/**
+		 * @brief content and dirty spans of a display with the dimensions at runtime
+		 *
+		 * Lets the diff be shared by all display sizes, see SDDS_TDS_SHARED_CORE.
+		 */
+		struct TtextGrid{
+			const char* curr;
+			const char* next;
+			const dtypes::uint8* dirtyFirst;
+			const dtypes::uint8* dirtyLast;
+			const dtypes::uint8* rowPriority;
+			int rows;
+			int columns;
+		};
+
+		/**
+		 * @brief changes of a row, only the span written since the last update is compared
+		 */
+		SDDS_TDS_SHARED TrowChanges tdsRowChanges(const TtextGrid& _grid, int _row, dtypes::uint32 _dirtyRows, dtypes::uint32 _forcedRows){
+			TrowChanges c = {};
+			if (_row >= _grid.rows || !(_dirtyRows & (dtypes::uint32(1) << _row))) return c;
+
+			auto curr = _grid.curr + _row*_grid.columns;
+			auto next = _grid.next + _row*_grid.columns;
+			if (_forcedRows & (dtypes::uint32(1) << _row)){
+				c._buffer = next;
+				c.firstChangedIdx = 0;
+				c.lastChangedIdx = _grid.columns-1;
+				c.n = _grid.columns;
+				c.row = _row;
+				return c;
+			}
+
+			int last = _grid.dirtyLast[_row];
+			for (auto i = _grid.dirtyFirst[_row]; i <= last; i++){
+				if (curr[i] != next[i]){
+					c._buffer = &next[i];
+					c.firstChangedIdx = i;
+					break;
+				} 
+			}
+			if (c._buffer){
+				for (auto i = last; i >= c.firstChangedIdx; i--){
+					if (curr[i] != next[i]){
+						c.lastChangedIdx = i;
+						break;
+					}
+				}
+				c.n = c.lastChangedIdx-c.firstChangedIdx+1;
+				c.row = _row;
+			}
+			return c;
+		}
+
+		/**
+		 * @brief find the pending row with the highest priority
+		 *
+		 * Rows of the same priority are served round robin starting at _firstRow.
+		 * Rows that turn out to have no changes anymore are removed from _dirtyRows.
+		 *
+		 * @param _focusRow row of the cursor, always TrowPriority::FOCUS
+		 * @return TrowChanges of the row to be sent next, hasChanges() is false if nothing is pending
+		 */
+		SDDS_TDS_SHARED TrowChanges tdsNextRowChanges(const TtextGrid& _grid, dtypes::uint32& _dirtyRows, dtypes::uint32 _forcedRows, int _firstRow, int _focusRow){
+			TrowChanges best = {};
+			dtypes::uint8 bestPriority = 0xFF;
+			for (auto i = 0; i < _grid.rows && _dirtyRows; i++){
+				auto row = _firstRow + i < _grid.rows ? _firstRow + i : _firstRow + i - _grid.rows;
+				if (!(_dirtyRows & (dtypes::uint32(1) << row))) continue;
+				dtypes::uint8 prio = row == _focusRow ? dtypes::uint8(TrowPriority::FOCUS) : _grid.rowPriority[row];
+				if (prio >= bestPriority) continue;
+				auto c = tdsRowChanges(_grid,row,_dirtyRows,_forcedRows);
+				if (!c.hasChanges()){
+					_dirtyRows &= ~(dtypes::uint32(1) << row);
+					continue;
+				}
+				best = c;
+				bestPriority = prio;
+				if (prio == TrowPriority::FOCUS) break;
+			}
+			return best;
+		}
+
 		class TabstractTextDisplayInterface : public Tthread{
 			protected:
 				Tevent FupdateEvent;
@@ -42,11 +149,37 @@ namespace sdds{
 				//to be called by specialization if display is ready to receive new commands
 				void onTaskDone() { FevHandshake.signal(); };
 
+				//false while the display is starting up, the content is prepared but nothing is sent
+				bool Fready = true;
+
+				//to be called by specializations that have cleared Fready once the display answers
+				void setReady(){
+					Fready = true;
+					FupdateEvent.signal();
+				}
+
+				//bytes a backend needs for one command on top of the text (framing, position, ...)
+				//used to charge the link budget, see setByteBudget
+				int FcommandOverhead = 0;
+
+				//behaviour of the hardware cursor (address counter), to be set by the specialization
+				bool FwriteMovesCursor = false;		//writing text advances the cursor (HD44780)
+				bool FclearHomesCursor = false;		//clear moves the cursor to 0;0
+
+				//character code of the first user defined glyph, -1 if the display has none
+				int FglyphBase = -1;
+
+				//translation of Latin-1 to the character ROM, applied when text is written, see uCharset.h
+				const dtypes::uint8* Fcharset = nullptr;
+
 				//to be overridden by the deriving class
-				virtual void doClear(){ }
-				virtual void doSetCursor(const TcursorInterface _cursor){ }
-				virtual void doUpdateRow(const TrowChanges _changes){}
+				SDDS_TDS_VIRTUAL void doClear(){ }
+				SDDS_TDS_VIRTUAL void doSetCursor(const TcursorInterface _cursor){ }
+				SDDS_TDS_VIRTUAL void doUpdateRow(const TrowChanges _changes){}
+				SDDS_TDS_VIRTUAL void doDefineGlyph(int _slot, const Tglyph& _glyph){ onTaskDone(); }
 			public:
+				bool ready(){ return Fready; }
+
 				TabstractTextDisplayInterface()
 					: FupdateEvent(this)
 					, FevHandshake(this,1)
@@ -55,118 +188,657 @@ namespace sdds{
 				}
 		};
 
-		template <int nRows, int nColumns>
-		class TabstractTextDisplay : public TabstractTextDisplayInterface{
+		/**
+		 * @brief backend TabstractTextDisplay calls, void dispatches through the virtual functions
+		 *
+		 * usage in a backend:
+		 *	class Tlcd : public TabstractTextDisplay<4,20,typename TdispatchTo<Tlcd>::type>{
+		 *		template <int, int, class> friend class TabstractTextDisplay;
+		 */
+		template <class Tbackend>
+		struct TdispatchTo{
+#if SDDS_TDS_STATIC_DISPATCH == 1
+			typedef Tbackend type;
+#else
+			//all backends of a size share one instantiation of the core
+			typedef void type;
+#endif
+		};
+
+		template <class T> struct TisVoid{ constexpr static bool value = false; };
+		template <> struct TisVoid<void>{ constexpr static bool value = true; };
+
+		/**
+		 * @tparam Tbackend deriving class to call the do* functions of directly, see TdispatchTo
+		 */
+		template <int nRows, int nColumns, class Tbackend = void>
+		class TabstractTextDisplay : public TabstractTextDisplayInterface, public ToverlayHost{
+			static_assert(nRows <= 32, "dirty rows are tracked in a 32 bit mask");
+			static_assert(nColumns <= 255, "dirty spans are tracked in 8 bit");
 			private:
 				TdisplayBuffer<nRows,nColumns> FcurrContent;
 				TdisplayBuffer<nRows,nColumns> FnextContent;
 				bool FclearScreen = false; 
+				dtypes::uint32 FdirtyRows = 0;
+				//columns written since the row has been sent, only valid for dirty rows
+				dtypes::uint8 FdirtyFirst[nRows];
+				dtypes::uint8 FdirtyLast[nRows];
+				dtypes::uint8 FrowPriority[nRows];
+
+				//rows resent although the mirror says they are unchanged, see setScrubRate
+				dtypes::uint32 FforcedRows = 0;
+				Tevent FevScrub;
+				int FscrubRate = 0;
+				int FscrubRow = 0;
+
+				Tevent FevBudget;
+				int FbudgetPerTick = 0;		//0 = unlimited
+				int FbudgetTick = 10;
+				int FbudgetCredit = 0;
+				bool FbudgetTimerActive = false;
+
+#if SDDS_TDS_ASYNC_WRITES == 1
+				TasyncRows<nRows,nColumns> FasyncRows;
+				Tevent FevAsync;
+				int FasyncPoll = 0;
+#endif
 			protected:
 
 			public:
 				typedef Tcursor<nRows,nColumns> _Tcursor;
 				constexpr static int N_LINES = nRows;
 				constexpr static int N_COLUMNS = nColumns;
+				constexpr static int MAX_OVERLAYS = 4;
 
 				TabstractTextDisplay()
+					: FevScrub(this)
+					, FevBudget(this)
+#if SDDS_TDS_ASYNC_WRITES == 1
+					, FevAsync(this)
+#endif
 				{
 					FdisplayCursor.x = -1;
 					FdisplayCursor.y = -1;
+					for (auto row = 0; row < nRows; row++){
+						FrowPriority[row] = TrowPriority::VALUE;
+						for (auto col = 0; col < nColumns; col++)
+							FnextContent[row][col] = ' ';
+					}
+					//the display holds whatever it held before, the first update clears it and sends every row
+					invalidate();
 				}
 				
 				_Tcursor getCursor(){ return Fcursor; }
 
+				/**
+				 * @brief clear the display
+				 *
+				 * Within a frame only the content is blanked, so the rows written
+				 * afterwards are sent as difference instead of a clear followed by
+				 * all rows.
+				 */
 				void clear(){
+					if (FframeDepth > 0){
+						for (auto row=0; row< nRows; row++)
+							for (auto col=0; col < nColumns; col++)
+								write(row,col,' ');
+						return;
+					}
 					for (auto row=0; row< nRows; row++){
 						for (auto col=0; col < nColumns; col++){
 							FcurrContent[row][col] = ' ';
 							FnextContent[row][col] = ' ';
 						}
 					}
+					FdirtyRows = 0;
+					FforcedRows = 0;
 					FclearScreen = true;
-					FupdateEvent.signal();
+					requestUpdate();
+
+					//the overlays stay, only the content below is cleared
+					for (auto i = 0; i < FoverlayCount; i++){
+						forEachCell(*Foverlays[i],[this,i](int _row, int _col){
+							auto o = Foverlays[i];
+							if (lowestOverlay(_row,_col) == o) o->saveUnder(_row,_col) = ' ';
+							setContent(_row,_col,overlayContent(*o,_row,_col));
+						});
+					}
+				}
+
+				/**
+				 * @brief the display has lost its content (reconnect, reset), send everything again
+				 */
+				void invalidate(){
+					for (auto row=0; row< nRows; row++){
+						for (auto col=0; col < nColumns; col++)
+							FcurrContent[row][col] = ' ';
+						FdirtyFirst[row] = 0;
+						FdirtyLast[row] = nColumns-1;
+					}
+					FdirtyRows = (nRows < 32) ? (dtypes::uint32(1) << nRows) - 1 : ~dtypes::uint32(0);
+					FdisplayCursor.x = -1;
+					FdisplayCursor.y = -1;
+					FglyphCache.invalidate();
+					FclearScreen = true;
+					requestUpdate();
 				}
 
 				void setCursor(const _Tcursor _cursor){ 
 					Fcursor = _cursor;
-					FupdateEvent.signal();
+					requestUpdate();
 				}
 
+				/**
+				 * @brief write a Latin-1 character to the content
+				 *
+				 * The character is translated to the ROM of the display here, so
+				 * the content and the diff already hold what is sent. Cells covered
+				 * by overlays are written to their save-under.
+				 */
 				bool write(int _row, int _col, char c){
 					if ((_row >= nRows) || (_col >= nColumns)) return false;
-					FnextContent[_row][_col] = c;
-					FupdateEvent.signal();
+					if (Fcharset) c = translate(Fcharset,c);
+					if (auto o = lowestOverlay(_row,_col)){
+						o->saveUnder(_row,_col) = c;
+						return true;
+					}
+					setContent(_row,_col,c);
 					return true;
 				}
 
+#if SDDS_TDS_ASYNC_WRITES == 1
+				/**
+				 * @brief write Latin-1 text from another thread than the task handler
+				 *
+				 * The text is taken over on the next poll, see setAsyncPollInterval.
+				 * Never blocks on the display, the cells written this way should not
+				 * be written with write() as well.
+				 *
+				 * @return false if the text doesn't fit into the row
+				 */
+				bool writeAsync(int _row, int _col, const char* _text){
+					return FasyncRows.write(_row,_col,_text,strlen(_text));
+				}
+
+				/**
+				 * @brief enable writeAsync, has to be called from the task handler
+				 *
+				 * Events can't be signalled from other threads, so the rows written
+				 * by them are polled.
+				 *
+				 * @param _ms 0 stops polling
+				 */
+				void setAsyncPollInterval(int _ms){
+					auto wasPolling = FasyncPoll > 0;
+					FasyncPoll = _ms;
+					if (_ms > 0 && !wasPolling) FevAsync.setTimeEvent(_ms);
+				}
+
+				/**
+				 * @brief reads of async rows given up because writers kept them busy
+				 */
+				dtypes::uint32 asyncRetries() const { return FasyncRows.retries(); }
+#endif
+
+				/**
+				 * @brief show _overlay at _row;_col on top of the content and all other overlays
+				 *
+				 * The covered content is kept in the save-under of the overlay, so hiding it
+				 * only resends the covered cells. Showing a visible overlay again raises it.
+				 *
+				 * @param _dismissAfterMs hide the overlay automatically, 0 keeps it until hidden
+				 * @return false if there are already MAX_OVERLAYS overlays visible
+				 */
+				bool showOverlay(TtextOverlay& _overlay, int _row, int _col, dtypes::uint32 _dismissAfterMs = 0){
+					if (_overlay.Fhost) _overlay.Fhost->hideOverlay(_overlay);
+					if (FoverlayCount >= MAX_OVERLAYS) return false;
+
+					_overlay.Frow = _row;
+					_overlay.Fcol = _col;
+					forEachCell(_overlay,[this,&_overlay](int _row, int _col){
+						if (!lowestOverlay(_row,_col))
+							_overlay.saveUnder(_row,_col) = FnextContent[_row][_col];
+						setContent(_row,_col,overlayContent(_overlay,_row,_col));
+					});
+					Foverlays[FoverlayCount++] = &_overlay;
+					_overlay.Fhost = this;
+					//a timer of an earlier show must not hide an overlay shown without one
+					_overlay.FdismissTimer.stop();
+					if (_dismissAfterMs > 0) _overlay.FdismissTimer.start(_dismissAfterMs);
+					return true;
+				}
+
+				void hideOverlay(TtextOverlay& _overlay) override{
+					int idx = 0;
+					while (idx < FoverlayCount && Foverlays[idx] != &_overlay) idx++;
+					if (idx >= FoverlayCount) return;
+					_overlay.FdismissTimer.stop();
+
+					//the lowest overlay of a cell owns the content below, find them before removing
+					dtypes::uint8 lowestMask[nRows][(nColumns+7)/8] = {};
+					forEachCell(_overlay,[this,&_overlay,&lowestMask](int _row, int _col){
+						if (lowestOverlay(_row,_col) == &_overlay) lowestMask[_row][_col/8] |= 1 << (_col%8);
+					});
+
+					FoverlayCount--;
+					for (auto i = idx; i < FoverlayCount; i++)
+						Foverlays[i] = Foverlays[i+1];
+					_overlay.Fhost = nullptr;
+
+					forEachCell(_overlay,[this,&_overlay,&lowestMask](int _row, int _col){
+						auto top = topOverlay(_row,_col);
+						if (lowestMask[_row][_col/8] & (1 << (_col%8))){
+							auto lowest = lowestOverlay(_row,_col);
+							if (lowest) lowest->saveUnder(_row,_col) = _overlay.saveUnder(_row,_col);
+							else setContent(_row,_col,_overlay.saveUnder(_row,_col));
+						}
+						if (top) setContent(_row,_col,overlayContent(*top,_row,_col));
+					});
+				}
+
+				void overlayChanged(TtextOverlay& _overlay, int _row, int _col) override{
+					if (_row < 0 || _row >= nRows || _col < 0 || _col >= nColumns) return;
+					if (topOverlay(_row,_col) == &_overlay)
+						setContent(_row,_col,overlayContent(_overlay,_row,_col));
+				}
+
+			private:
+				int FframeDepth = 0;
+				bool FframeChanged = false;
+
+				TglyphCache<> FglyphCache;
+
+				//also true while the display still shows _code, a redefined slot would change those cells before they are sent
+				bool onScreen(int _code){
+					for (auto row = 0; row < nRows; row++){
+						if (memchr(FnextContent[row],_code,nColumns)) return true;
+						if (memchr(FcurrContent[row],_code,nColumns)) return true;
+					}
+					return false;
+				}
+
+				void requestUpdate(){
+					if (FframeDepth > 0) FframeChanged = true;
+					else FupdateEvent.signal();
+				}
+
+				//visible overlays, bottom to top
+				TtextOverlay* Foverlays[MAX_OVERLAYS];
+				int FoverlayCount = 0;
+
+				void setContent(int _row, int _col, char c){
+					if (FnextContent[_row][_col] == c) return;
+					FnextContent[_row][_col] = c;
+					auto rowBit = dtypes::uint32(1) << _row;
+					if (!(FdirtyRows & rowBit)){
+						FdirtyRows |= rowBit;
+						FdirtyFirst[_row] = _col;
+						FdirtyLast[_row] = _col;
+					}
+					else if (_col < FdirtyFirst[_row]) FdirtyFirst[_row] = _col;
+					else if (_col > FdirtyLast[_row]) FdirtyLast[_row] = _col;
+					requestUpdate();
+				}
+
+				char overlayContent(TtextOverlay& _overlay, int _row, int _col){
+					auto c = _overlay.displayContent(_row,_col);
+					return Fcharset ? translate(Fcharset,c) : c;
+				}
+
+				TtextOverlay* lowestOverlay(int _row, int _col){
+					for (auto i = 0; i < FoverlayCount; i++)
+						if (Foverlays[i]->covers(_row,_col)) return Foverlays[i];
+					return nullptr;
+				}
+
+				TtextOverlay* topOverlay(int _row, int _col){
+					for (auto i = FoverlayCount-1; i >= 0; i--)
+						if (Foverlays[i]->covers(_row,_col)) return Foverlays[i];
+					return nullptr;
+				}
+
+				/**
+				 * @brief call _f(row,col) for all cells of the overlay that are on the display
+				 */
+				template <class Tfunc>
+				void forEachCell(TtextOverlay& _overlay, Tfunc _f){
+					for (auto row = _overlay.Frow; row < _overlay.Frow + _overlay.Fheight; row++){
+						if (row < 0 || row >= nRows) continue;
+						for (auto col = _overlay.Fcol; col < _overlay.Fcol + _overlay.Fwidth; col++)
+							if (col >= 0 && col < nColumns) _f(row,col);
+					}
+				}
+
+			public:
+
+				/**
+				 * @brief collect the following changes and send them together on commitFrame
+				 *
+				 * Nothing is transmitted while a frame is open, so intermediate states
+				 * never reach the display. Whatever of the previous frame hasn't been
+				 * sent yet is superseded, only the difference to the committed frame is
+				 * sent. Frames can be nested, the outermost commit counts.
+				 */
+				void beginFrame(){ FframeDepth++; }
+
+				void commitFrame(){
+					if (FframeDepth == 0) return;
+					if (--FframeDepth == 0 && FframeChanged){
+						FframeChanged = false;
+						FupdateEvent.signal();
+					}
+				}
+
+				/**
+				 * @brief true as long as changes haven't been sent to the display
+				 */
+				bool updatePending(){
+					return FclearScreen || FdirtyRows || cursorChanged() || FglyphCache.pending() || FframeDepth > 0;
+				}
+
+				/**
+				 * @brief use another character ROM table than the default of the backend
+				 *
+				 * Only affects text written afterwards, nullptr disables the translation.
+				 */
+				void setCharset(const dtypes::uint8* _table){ Fcharset = _table; }
+
+				/**
+				 * @brief character code to write for a user defined glyph
+				 *
+				 * The glyph is uploaded with the next update before any text, glyphs
+				 * already resident are reused. As long as a glyph is on the screen its
+				 * slot isn't replaced.
+				 *
+				 * @return code or -1 if the display has no glyphs or all are on the screen
+				 */
+				int glyph(const Tglyph& _glyph){
+					if (FglyphBase < 0) return -1;
+					int slot = FglyphCache.acquire(_glyph,[this](int _slot){ return onScreen(FglyphBase + _slot); });
+					if (slot < 0) return -1;
+					if (FglyphCache.pending()) requestUpdate();
+					return FglyphBase + slot;
+				}
+
+				/**
+				 * @brief set the priority a row is transmitted with, see TrowPriority
+				 *
+				 * The row of the cursor is always transmitted first regardless of this setting.
+				 */
+				void setRowPriority(int _row, dtypes::uint8 _priority){
+					if (_row < 0 || _row >= nRows) return;
+					FrowPriority[_row] = _priority;
+				}
+
+				/**
+				 * @brief limit the bytes sent to the display per tick
+				 *
+				 * Rows that don't contain the cursor are delayed until there is budget
+				 * left. The focus row and cursor movements are always sent immediately
+				 * and paid back from the following ticks, so interactive feedback stays
+				 * fast even if every row is changing.
+				 *
+				 * @param _bytesPerTick 0 disables the budget
+				 * @param _tickMs period the budget is refilled with
+				 */
+				void setByteBudget(int _bytesPerTick, int _tickMs = 10){
+					FbudgetPerTick = _bytesPerTick;
+					FbudgetTick = _tickMs > 0 ? _tickMs : 1;
+					FbudgetCredit = _bytesPerTick;
+				}
+
+				/**
+				 * @brief resend one row after the other while nothing else is sent
+				 *
+				 * Repairs the screen after lost packets or a brown out of the display
+				 * that the backend couldn't detect. A full pass also resends the cursor.
+				 * Rows are only scrubbed while no change is pending, so the scrubber
+				 * never delays an update by more than one row.
+				 *
+				 * @param _bytesPerSecond average bandwidth for scrubbing, 0 disables it
+				 */
+				void setScrubRate(int _bytesPerSecond){
+					auto wasRunning = FscrubRate > 0;
+					FscrubRate = _bytesPerSecond;
+					if (_bytesPerSecond > 0 && !wasRunning) FevScrub.setTimeEvent(scrubInterval());
+				}
+
+				/**
+				 * @brief bytes per tick an UART link with 8N1 can transfer
+				 */
+				constexpr static int budgetForBaudrate(dtypes::uint32 _baudrate, int _tickMs = 10){
+					return static_cast<int>(_baudrate / 10 * _tickMs / 1000);
+				}
+
 			protected:
 				_Tcursor Fcursor;
 				_Tcursor FdisplayCursor;
 
+				/**
+				 * @brief changes of a row, only the span written since the last update is compared
+				 */
 				TrowChanges getChangesInRow(int _row){
-					TrowChanges c = {};
-					if (_row >= nRows) return c;
-
-					for (auto i = 0; i < nColumns; i++){
-						if (FcurrContent[_row][i] != FnextContent[_row][i]){
-							c._buffer = &FnextContent[_row][i];
-							c.firstChangedIdx = i;
-							break;
-						} 
-					}
-					if (c._buffer){
-						for (auto i = c.firstChangedIdx; i < nColumns; i++){
-							if (FcurrContent[_row][i] != FnextContent[_row][i])
-								c.lastChangedIdx = i;
-						}
-						c.n = c.lastChangedIdx-c.firstChangedIdx+1;
-						c.row = _row;
-					}
-					return c;
+					return tdsRowChanges(grid(),_row,FdirtyRows,FforcedRows);
 				}	
 
 			private:
 				int FrowToUpdate = 0; 
-				
-				bool _handleUpdate(int _firstRow, int _lastRow){
-					while (_firstRow <= _lastRow){
-						auto c = getChangesInRow(_firstRow);
-						if (c.hasChanges()){
-							FrowToUpdate = _firstRow+1 < nRows? _firstRow+1 : 0;
-							doUpdateRow(c);
-							memcpy(&FcurrContent[c.row][c.firstChangedIdx],&FnextContent[c.row][c.firstChangedIdx],c.n);
-							setPriority(1);
-							return true;
-						}
-						_firstRow++;
+
+				dtypes::uint8 rowPriority(int _row){
+					if (_row == Fcursor.y) return TrowPriority::FOCUS;
+					return FrowPriority[_row];
+				}
+
+				TtextGrid grid(){
+					return TtextGrid{FcurrContent[0],FnextContent[0],FdirtyFirst,FdirtyLast,FrowPriority,nRows,nColumns};
+				}
+
+				/**
+				 * @return TrowChanges of the row to be sent next, see tdsNextRowChanges
+				 */
+				TrowChanges nextRowChanges(){
+					return tdsNextRowChanges(grid(),FdirtyRows,FforcedRows,FrowToUpdate,Fcursor.y);
+				}
+
+				/**
+				 * @brief charge the budget for a transmission
+				 *
+				 * @param _force send even if the budget is used up (focus row, cursor)
+				 * @return false if the transmission has to wait for the next tick
+				 */
+				bool chargeBudget(int _bytes, bool _force){
+					if (FbudgetPerTick <= 0) return true;
+					if (!_force && FbudgetCredit <= 0){
+						startBudgetTimer();
+						return false;
 					}
-					return false;
+					FbudgetCredit -= _bytes + FcommandOverhead;
+					startBudgetTimer();
+					return true;
+				}
+
+				void startBudgetTimer(){
+					if (FbudgetTimerActive) return;
+					FbudgetTimerActive = true;
+					FevBudget.setTimeEvent(FbudgetTick);
+				}
+
+				void onBudgetTick(){
+					FbudgetTimerActive = false;
+					FbudgetCredit += FbudgetPerTick;
+					if (FbudgetCredit >= FbudgetPerTick)
+						FbudgetCredit = FbudgetPerTick;
+					else
+						startBudgetTimer();
+				}
+
+				bool cursorChanged(){
+					return (Fcursor.x != FdisplayCursor.x) || (Fcursor.y != FdisplayCursor.y);
+				}
+
+				/**
+				 * @brief follow the address counter of displays where writing text moves the cursor
+				 *
+				 * The position command is skipped if the previous write ended where this one
+				 * starts. The cursor is restored together with the last pending row instead of
+				 * after every row.
+				 */
+				void trackAddressCounter(TrowChanges& c){
+					if (!FwriteMovesCursor) return;
+
+					c.setPosition = (FdisplayCursor.x != c.firstChangedIdx) || (FdisplayCursor.y != c.row);
+					FdisplayCursor.x = c.firstChangedIdx + c.n;
+					FdisplayCursor.y = c.row;
+					//the address counter wraps to another row at the end of a line, that depends on the display
+					if (FdisplayCursor.x >= nColumns) FdisplayCursor.x = -1;
+
+					auto otherRowsPending = (FdirtyRows & ~(dtypes::uint32(1) << c.row)) != 0;
+					if (!otherRowsPending && !FclearScreen && cursorChanged()){
+						c.restoreCursor = true;
+						c.cursor = Fcursor;
+						FdisplayCursor = Fcursor;
+					}
+				}
+
+#if SDDS_TDS_STATIC_DISPATCH == 1
+				Tbackend& backend(){
+					static_assert(!TisVoid<Tbackend>::value, "SDDS_TDS_STATIC_DISPATCH requires the backend to name itself, see TdispatchTo");
+					return *static_cast<Tbackend*>(this);
+				}
+#else
+				TabstractTextDisplay& backend(){ return *this; }
+#endif
+
+				void updateRow(TrowChanges& c){
+					FrowToUpdate = c.row+1 < nRows? c.row+1 : 0;
+					trackAddressCounter(c);
+					backend().doUpdateRow(c);
+					memcpy(&FcurrContent[c.row][c.firstChangedIdx],&FnextContent[c.row][c.firstChangedIdx],c.n);
+					FdirtyRows &= ~(dtypes::uint32(1) << c.row);
+					FforcedRows &= ~(dtypes::uint32(1) << c.row);
+					setPriority(1);
+				}
+
+				void updateCursor(){
+					FdisplayCursor = Fcursor;
+					chargeBudget(0,true);
+					backend().doSetCursor(Fcursor);
+					setPriority(1);
 				}
 
+				void updateGlyph(int _slot){
+					chargeBudget(Tglyph::N_ROWS+1,true);
+					//writing the glyph moves the address counter away from the screen
+					if (FwriteMovesCursor){
+						FdisplayCursor.x = -1;
+						FdisplayCursor.y = -1;
+					}
+					backend().doDefineGlyph(_slot,FglyphCache.glyph(_slot));
+					setPriority(1);
+				}
+
+				/**
+				 * @brief transmits the next pending change
+				 *
+				 * Nothing is sent before the backend is ready, the changes add up in the content.
+				 * order: clear screen, glyphs, row of the cursor, cursor position, 
+				 * value rows and finally background rows.
+				 */
 				void handleUpdate(){
+					if (FframeDepth > 0 || !Fready){
+						setPriority(0);
+						return;
+					}
+
 					if (FclearScreen){
 						FclearScreen = false;
-						doClear();
+						chargeBudget(0,true);
+						if (FclearHomesCursor){
+							FdisplayCursor.x = 0;
+							FdisplayCursor.y = 0;
+						}
+						backend().doClear();
 						setPriority(1);
 						return;
 					}
 
-					if ((Fcursor.x != FdisplayCursor.x) || (Fcursor.y != FdisplayCursor.y)){
-						FdisplayCursor = Fcursor;
-						doSetCursor(Fcursor);
-						setPriority(1);
+					auto glyphSlot = FglyphCache.takePending();
+					if (glyphSlot >= 0) return updateGlyph(glyphSlot);
+
+					auto c = nextRowChanges();
+					if (c.hasChanges() && rowPriority(c.row) == TrowPriority::FOCUS){
+						chargeBudget(c.n,true);
+						updateRow(c);
 						return;
 					}
 
-					auto updateStart = FrowToUpdate;
-					if (_handleUpdate(updateStart,nRows-1)) return;
-					if (_handleUpdate(0,updateStart-1)) return;
+					//if writing moves the cursor, it is restored with the last pending row
+					if (cursorChanged() && !(FwriteMovesCursor && c.hasChanges()))
+						return updateCursor();
+
+					if (c.hasChanges()){
+						if (chargeBudget(c.n,false)) updateRow(c);
+						else if (cursorChanged()) updateCursor();
+						else setPriority(0);
+						return;
+					}
 					
 					setPriority(0);
 					FrowToUpdate = 0;
 				}
 				
+#if SDDS_TDS_ASYNC_WRITES == 1
+				void applyAsyncRows(){
+					auto pending = FasyncRows.takePending();
+					for (auto row = 0; pending; row++, pending >>= 1){
+						if (!(pending & 1)) continue;
+						dtypes::int16 text[nColumns];
+						int first, last;
+						if (!FasyncRows.read(row,text,first,last)) continue;
+						for (auto col = first; col <= last; col++)
+							if (text[col] != TasyncRows<nRows,nColumns>::UNUSED) write(row,col,static_cast<char>(text[col]));
+					}
+				}
+#endif
+
+				int scrubInterval(){
+					int ms = (nColumns + FcommandOverhead) * 1000 / FscrubRate;
+					return ms > 0 ? ms : 1;
+				}
+
+				/**
+				 * @brief the event only runs while no command is in progress, see setPriority
+				 */
+				void scrub(){
+					if (FscrubRate <= 0) return;
+					if (Fready && !updatePending()){
+						auto rowBit = dtypes::uint32(1) << FscrubRow;
+						FforcedRows |= rowBit;
+						FdirtyRows |= rowBit;
+						FdirtyFirst[FscrubRow] = 0;
+						FdirtyLast[FscrubRow] = nColumns-1;
+						if (++FscrubRow >= nRows){
+							FscrubRow = 0;
+							FdisplayCursor.x = -1;
+							FdisplayCursor.y = -1;
+						}
+						requestUpdate();
+					}
+					FevScrub.setTimeEvent(scrubInterval());
+				}
+
 				void execute(Tevent* _ev) override{
+					if (_ev == &FevScrub) scrub();
+#if SDDS_TDS_ASYNC_WRITES == 1
+					if (_ev == &FevAsync){
+						applyAsyncRows();
+						if (FasyncPoll > 0) FevAsync.setTimeEvent(FasyncPoll);
+					}
+#endif
+					if (_ev == &FevBudget){
+						onBudgetTick();
+						handleUpdate();
+					}
 					if (_ev == &FupdateEvent || _ev == &FevHandshake)
 						handleUpdate();
 					if (isTaskEvent(_ev)){
@@ -179,36 +851,6 @@ namespace sdds{
 
 		};
 
-		/*
-		template <int First, int... Rest>
-		struct Sum {
-			static constexpr int value = First + Sum<Rest...>::value;
-		};
-
-		template <int Last>
-		struct Sum<Last> {
-			static constexpr int value = Last;
-		};
-
-		template <int nRows, int... colWidths>
-		class TtableTextDisplay : public TabstractTextDisplay<nRows,Sum<colWidths...>::value> {
-			public:
-			constexpr static int colWidthsArray[] = {colWidths...}; // Array mit Spaltenbreiten
-			static constexpr int nColumns = sizeof...(colWidths);
-			static constexpr int nTotalWidth = Sum<colWidths...>::value;
-
-			void test(){
-				int colW = colWidthsArray[0];
-				std::cout<<colW<<std::endl;
-			}
-		};
-
-		class TtestDisplay : public TtableTextDisplay<4,30,30>{
-
-		} testDisp;
-
-		*/
-
 	}
 }
 
@@ -0,0 +1,134 @@
+#ifndef UASYNCROWS_H
+#define UASYNCROWS_H
+
+#include "uTypedef.h"
+
+#ifndef SDDS_TDS_ASYNC_WRITES
+	//writes from other threads than the task handler, needs std::atomic
+	#if SDDS_ON_ARDUINO != 1 || defined(ESP32)
+		#define SDDS_TDS_ASYNC_WRITES 1
+	#else
+		#define SDDS_TDS_ASYNC_WRITES 0
+	#endif
+#endif
+
+#if SDDS_TDS_ASYNC_WRITES == 1
+
+#include <atomic>
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief rows written by other threads, read by the thread of the display
+		 *
+		 * Every row is protected by a seqlock: a writer makes the sequence odd,
+		 * writes and makes it even again. The reader copies the row and accepts
+		 * the copy only if the sequence was even and unchanged, so it never sees a
+		 * torn row and never waits for a writer. Writers of the same row wait for
+		 * each other, never for the reader.
+		 *
+		 * Only the columns ever written here are taken over into the display,
+		 * the rest of the row belongs to the task handler.
+		 */
+		template <int nRows, int nColumns>
+		class TasyncRows{
+			public:
+				constexpr static dtypes::int16 UNUSED = -1;
+
+				TasyncRows(){
+					for (auto& r : Frows)
+						for (auto& c : r.text)
+							c.store(UNUSED,std::memory_order_relaxed);
+				}
+
+				/**
+				 * @brief copy _n characters to _row;_col, callable from any thread
+				 *
+				 * @return false if the text doesn't fit into the row
+				 */
+				bool write(int _row, int _col, const char* _text, int _n){
+					if (_row < 0 || _row >= nRows || _col < 0 || _n <= 0 || _col + _n > nColumns) return false;
+					auto& r = Frows[_row];
+
+					auto seq = r.seq.load(std::memory_order_relaxed);
+					while ((seq & 1) || !r.seq.compare_exchange_weak(seq,seq+1,std::memory_order_acquire,std::memory_order_relaxed))
+						seq = r.seq.load(std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_release);
+
+					for (auto i = 0; i < _n; i++)
+						r.text[_col+i].store(static_cast<dtypes::uint8>(_text[i]),std::memory_order_relaxed);
+					auto first = r.first.load(std::memory_order_relaxed);
+					auto last = r.last.load(std::memory_order_relaxed);
+					if (first > last){
+						r.first.store(_col,std::memory_order_relaxed);
+						r.last.store(_col+_n-1,std::memory_order_relaxed);
+					}
+					else{
+						if (_col < first) r.first.store(_col,std::memory_order_relaxed);
+						if (_col+_n-1 > last) r.last.store(_col+_n-1,std::memory_order_relaxed);
+					}
+
+					r.seq.store(seq+2,std::memory_order_release);
+					Fpending.fetch_or(dtypes::uint32(1) << _row,std::memory_order_release);
+					return true;
+				}
+
+				/**
+				 * @brief rows written since the last call, the bits are cleared
+				 */
+				dtypes::uint32 takePending(){
+					return Fpending.exchange(0,std::memory_order_acquire);
+				}
+
+				/**
+				 * @brief consistent copy of the columns _first.._last of _row
+				 *
+				 * Columns in between that have never been written are UNUSED.
+				 *
+				 * If writers keep the row busy for all attempts, the row is marked
+				 * pending again and false is returned, the caller tries on the next poll.
+				 */
+				bool read(int _row, dtypes::int16* _text, int& _first, int& _last){
+					auto& r = Frows[_row];
+					for (auto attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++){
+						auto seq = r.seq.load(std::memory_order_acquire);
+						if (seq & 1) continue;
+						_first = r.first.load(std::memory_order_relaxed);
+						_last = r.last.load(std::memory_order_relaxed);
+						for (auto i = _first; i <= _last; i++)
+							_text[i] = r.text[i].load(std::memory_order_relaxed);
+						std::atomic_thread_fence(std::memory_order_acquire);
+						if (r.seq.load(std::memory_order_relaxed) == seq) return _first <= _last;
+					}
+					Fretries.fetch_add(1,std::memory_order_relaxed);
+					Fpending.fetch_or(dtypes::uint32(1) << _row,std::memory_order_relaxed);
+					return false;
+				}
+
+				/**
+				 * @brief number of reads given up because of busy writers
+				 */
+				dtypes::uint32 retries() const { return Fretries.load(std::memory_order_relaxed); }
+
+			private:
+				constexpr static int MAX_READ_ATTEMPTS = 4;
+
+				struct Trow{
+					std::atomic<dtypes::uint32> seq{0};
+					std::atomic<dtypes::int16> first{nColumns};
+					std::atomic<dtypes::int16> last{-1};
+					std::atomic<dtypes::int16> text[nColumns];
+				};
+
+				Trow Frows[nRows];
+				std::atomic<dtypes::uint32> Fpending{0};
+				std::atomic<dtypes::uint32> Fretries{0};
+		};
+
+	}
+}
+
+#endif //SDDS_TDS_ASYNC_WRITES
+
+#endif //UASYNCROWS_H
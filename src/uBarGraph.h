@@ -0,0 +1,45 @@
+#ifndef UBARGRAPH_H
+#define UBARGRAPH_H
+
+#include "uTypedef.h"
+#include "uGlyphCache.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief horizontal bar with a resolution of 5 pixels per character
+		 *
+		 * The partially filled character uses one of 4 glyphs, full characters
+		 * another one, so a bar needs at most 2 of the 8 glyph slots at a time.
+		 * Without glyphs the bar is drawn with '#' in full characters only.
+		 */
+		template <class Tdisplay>
+		void barGraphToDisplay(Tdisplay& _display, int _row, int _col, int _width, dtypes::float32 _fraction){
+			constexpr int PIXELS = 5;
+			if (!(_fraction > 0)) _fraction = 0;		//also catches NaN
+			if (_fraction > 1) _fraction = 1;
+			int pixels = static_cast<int>(_fraction * _width * PIXELS + 0.5f);
+
+			for (auto i = 0; i < _width; i++){
+				int filled = pixels > PIXELS ? PIXELS : pixels;
+				pixels -= filled;
+				if (filled <= 0){
+					_display.write(_row,_col+i,' ');
+					continue;
+				}
+
+				Tglyph glyph;
+				dtypes::uint8 rowBits = (0x1F << (PIXELS - filled)) & 0x1F;
+				for (auto r = 0; r < Tglyph::N_ROWS; r++)
+					glyph.rows[r] = rowBits;
+				int code = _display.glyph(glyph);
+				if (code < 0) code = filled == PIXELS ? '#' : ' ';
+				_display.write(_row,_col+i,code);
+			}
+		}
+
+	}
+}
+
+#endif //UBARGRAPH_H
@@ -0,0 +1,132 @@
+#ifndef UCHARSET_H
+#define UCHARSET_H
+
+#include "uTypedef.h"
+
+#if defined(__AVR__)
+	#include <avr/pgmspace.h>
+	#define SDDS_TDS_CHARSET_ATTR PROGMEM
+#else
+	#define SDDS_TDS_CHARSET_ATTR
+#endif
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief code of the display for a Latin-1 character
+		 *
+		 * Tables map all 256 Latin-1 characters to the character ROM of a display.
+		 * Characters the ROM doesn't have are replaced by the closest ASCII character
+		 * or '?'. 0..31 are never translated, user defined glyphs live there.
+		 */
+		inline char translate(const dtypes::uint8* _table, char _c){
+#if defined(__AVR__)
+			return pgm_read_byte(&_table[static_cast<dtypes::uint8>(_c)]);
+#else
+			return _table[static_cast<dtypes::uint8>(_c)];
+#endif
+		}
+
+		/**
+		 * @brief HD44780 with ROM code A00 (japanese), the common one
+		 *
+		 * no backslash and tilde, they show as yen and arrow
+		 */
+		struct ThdA00Charset{
+			static const dtypes::uint8* table(){
+				static const dtypes::uint8 SDDS_TDS_CHARSET_ATTR t[256] = {
+				0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+				0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+				0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+				0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+				0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+				0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0x5B,0x2F,0x5D,0x5E,0x5F,
+				0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+				0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0x7B,0x7C,0x7D,0x2D,0x7F,
+				0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,
+				0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,
+				0x20,0x21,0xEC,0x4C,0x3F,0x5C,0x7C,0x3F,0x22,0x63,0x61,0x3C,0x3F,0x2D,0x52,0x3F,
+				0xDF,0x2B,0x32,0x33,0x27,0xE4,0x3F,0xA5,0x2C,0x31,0x6F,0x3E,0x3F,0x3F,0x3F,0x3F,
+				0x41,0x41,0x41,0x41,0x41,0x41,0x41,0x43,0x45,0x45,0x45,0x45,0x49,0x49,0x49,0x49,
+				0x44,0x4E,0x4F,0x4F,0x4F,0x4F,0x4F,0x78,0x4F,0x55,0x55,0x55,0x55,0x59,0x50,0xE2,
+				0x61,0x61,0x61,0x61,0xE1,0x61,0x61,0x63,0x65,0x65,0x65,0x65,0x69,0x69,0x69,0x69,
+				0x64,0xEE,0x6F,0x6F,0x6F,0x6F,0xEF,0xFD,0x6F,0x75,0x75,0x75,0xF5,0x79,0x70,0x79
+				};
+				return t;
+			}
+		};
+
+		/**
+		 * @brief Crystalfontz CFA635
+		 *
+		 * The ROM follows ISO 646: umlauts, N tilde, section and inverted marks
+		 * replace $ @ [ \ ] ^ _ ` { | } ~, which moved to the upper half. Degree,
+		 * micro, plus-minus and superscripts are at 128..143.
+		 */
+		struct Tcfa635Charset{
+			static const dtypes::uint8* table(){
+				static const dtypes::uint8 SDDS_TDS_CHARSET_ATTR t[256] = {
+				0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,
+				0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1A,0x1B,0x1C,0x1D,0x1E,0x1F,
+				0x20,0x21,0x22,0x23,0xA2,0x25,0x26,0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,
+				0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3A,0x3B,0x3C,0x3D,0x3E,0x3F,
+				0xA0,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,0x4D,0x4E,0x4F,
+				0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5A,0xFA,0xFB,0xFC,0x1D,0xC4,
+				0x27,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,
+				0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7A,0xFD,0xFE,0xFF,0xCE,0x20,
+				0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,
+				0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,0x3F,
+				0x20,0x40,0x63,0xA1,0x24,0xA3,0xFE,0x5F,0x22,0x63,0x61,0x3C,0x3F,0x2D,0x52,0x3F,
+				0x80,0x8C,0x82,0x83,0x27,0x8F,0x3F,0x2E,0x2C,0x81,0x80,0x3E,0x3F,0x3F,0x3F,0x60,
+				0x41,0x41,0x41,0x41,0x5B,0x41,0x41,0x43,0x45,0x45,0x45,0x45,0x49,0x49,0x49,0x49,
+				0x44,0x5D,0x4F,0x4F,0x4F,0x4F,0x5C,0x78,0x4F,0x55,0x55,0x55,0x5E,0x59,0x50,0xBE,
+				0x7F,0x61,0x61,0x61,0x7B,0x61,0x61,0x63,0xA4,0xA5,0x65,0x65,0x69,0x69,0x69,0x69,
+				0x64,0x7D,0x6F,0x6F,0x6F,0x6F,0x7C,0x2F,0x6F,0x75,0x75,0x75,0x7E,0x79,0x70,0x79
+				};
+				return t;
+			}
+		};
+
+		/**
+		 * @brief small UTF-8 decoder for texts that go to the display
+		 *
+		 * Code points above 255 become '?'. Bytes that don't form a valid
+		 * sequence are taken as Latin-1, so Latin-1 texts work as well.
+		 */
+		struct Tutf8{
+			/**
+			 * @brief next character of _str as Latin-1, _str is advanced behind it
+			 */
+			static char next(const char*& _str){
+				auto s = reinterpret_cast<const dtypes::uint8*>(_str);
+				int n = (s[0] >= 0xF0) ? 3 : (s[0] >= 0xE0) ? 2 : (s[0] >= 0xC0) ? 1 : 0;
+				dtypes::uint32 cp = s[0] & (0x3F >> n);
+				for (auto i = 1; i <= n; i++){
+					if ((s[i] & 0xC0) != 0x80){
+						_str++;
+						return s[0];
+					}
+					cp = (cp << 6) | (s[i] & 0x3F);
+				}
+				_str += n+1;
+				return n == 0 ? s[0] : cp <= 0xFF ? static_cast<char>(cp) : '?';
+			}
+
+			/**
+			 * @brief number of characters in _str
+			 */
+			static int length(const char* _str){
+				int len = 0;
+				while (*_str != '\0'){
+					next(_str);
+					len++;
+				}
+				return len;
+			}
+		};
+
+	}
+}
+
+#endif //UCHARSET_H
@@ -0,0 +1,95 @@
+#ifndef UCHILDINDEX_H
+#define UCHILDINDEX_H
+
+#include "uTypedef.h"
+#include <new>			//required for AVR-GCC
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief random access to the children of a menu
+		 *
+		 * TmenuHandle::iterator(idx) and TmenuHandle::get(idx) walk the children
+		 * from the start. The index stores iterators to the children, so seeking
+		 * is O(1) for menus up to CAPACITY children. Larger menus store every n-th
+		 * child, seeking walks at most n-1 children then.
+		 *
+		 * The index is built lazily on the first access and rebuilt if another menu
+		 * is accessed or checkStructure has found a change.
+		 */
+		template <int CAPACITY>
+		class TchildIndex{
+				static TmenuHandle& declMenu();	//only used in decltype
+			public:
+				typedef decltype(declMenu().iterator(0)) Titerator;
+
+				void invalidate(){ Fmenu = nullptr; }
+
+				/**
+				 * @brief rebuild on the next access if the number of children of _menu has changed
+				 *
+				 * Counting may walk all children, so it is up to the caller to check once
+				 * per screen update or key tick instead of on every seek.
+				 */
+				void checkStructure(TmenuHandle* _menu){
+					if (_menu == Fmenu && _menu->childCount() != Fcount) invalidate();
+				}
+
+				Titerator iterator(TmenuHandle* _menu, int _idx){
+					if (!valid(_menu)) build(_menu);
+					if (_idx < 0 || _idx >= Findexed) return _menu->iterator(_idx);
+
+					Titerator it = Fentries[_idx / Fstride].it;
+					for (auto i = _idx % Fstride; i > 0; i--)
+						it.jumpToNext();
+					return it;
+				}
+
+				Tdescr* get(TmenuHandle* _menu, int _idx){
+					auto it = iterator(_menu,_idx);
+					return it.hasCurrent() ? it.current() : nullptr;
+				}
+
+				int childCount(TmenuHandle* _menu){
+					if (!valid(_menu)) build(_menu);
+					return Fcount;
+				}
+
+			private:
+				union Tentry{
+					Tentry(){};
+					~Tentry(){};
+					Titerator it;
+				};
+				Tentry Fentries[CAPACITY];
+				TmenuHandle* Fmenu = nullptr;
+				int Fcount = 0;
+				int Findexed = 0;
+				int Fstride = 1;
+
+				bool valid(TmenuHandle* _menu){
+					return _menu == Fmenu;
+				}
+
+				void build(TmenuHandle* _menu){
+					Fmenu = _menu;
+					Fcount = _menu->childCount();
+					Fstride = (Fcount + CAPACITY - 1) / CAPACITY;
+					if (Fstride < 1) Fstride = 1;
+
+					auto it = _menu->iterator(0);
+					Findexed = 0;
+					while (Findexed < Fcount && it.hasCurrent()){
+						if (Findexed % Fstride == 0)
+							new (&Fentries[Findexed / Fstride].it) Titerator(it);
+						it.jumpToNext();
+						Findexed++;
+					}
+				}
+		};
+
+	}
+}
+
+#endif //UCHILDINDEX_H
@@ -9,8 +9,14 @@ namespace sdds{
 	namespace textDisplaySpike{
 
 		template <int nRows, int nColumns>
-		class TconsoleDisplay : public TabstractTextDisplay<nRows,nColumns>{
+		class TconsoleDisplay : public TabstractTextDisplay<nRows,nColumns,typename TdispatchTo<TconsoleDisplay<nRows,nColumns>>::type>{
+			template <int, int, class> friend class TabstractTextDisplay;
 			public:
+				TconsoleDisplay(){
+					//"\033[H" of clearScreen homes the cursor
+					this->FclearHomesCursor = true;
+				}
+
 				constexpr static int SDDS_TDS_KEY_LEFT = 75;
 				constexpr static int SDDS_TDS_KEY_RIGHT = 77;
 				constexpr static int SDDS_TDS_KEY_UP = 72;
@@ -38,18 +44,18 @@ namespace sdds{
 					WriteConsoleOutputCharacter(hConsole, text, length, position, &written);
 				}
 
-				void doSetCursor(const TcursorInterface _cursor) override{ 
+			protected:
+				void doSetCursor(const TcursorInterface _cursor) SDDS_TDS_OVERRIDE{ 
 					gotoxy(_cursor.x,_cursor.y);
 					this->onTaskDone();
 				}
 
-				void doClear() override{
+				void doClear() SDDS_TDS_OVERRIDE{
 					clearScreen();
-					gotoxy(this->getCursor().x,this->getCursor().y);
 					this->onTaskDone();
 				}
 				
-				void doUpdateRow(TrowChanges _changes) override {
+				void doUpdateRow(TrowChanges _changes) SDDS_TDS_OVERRIDE{
 					writeToConsole(_changes.firstChangedIdx, _changes.row, _changes._buffer, _changes.n);
 					this->onTaskDone();
 				}
@@ -60,4 +66,4 @@ namespace sdds{
 	}
 }
 
-#endif //UCONSOLEDISPLAY_H
\ No newline at end of file
+#endif //UCONSOLEDISPLAY_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define UCRYSTALFONTZCFA635_H
 
 #include "uAbstractTextDisplay.h"
+#include "uKeyRepeat.h"
 
 template <typename T, int MAX_ELEMENTS>
 class TringBuffer {
@@ -106,8 +107,98 @@ public:
 
 namespace sdds{
 	namespace textDisplaySpike{
+		/**
+		 * @brief CRC-16 as used by the CFA635 packet protocol
+		 *
+		 * shared by the driver and the host side simulator (uCrystalFontzCFA635Sim.h)
+		 */
+		inline dtypes::uint16 cfa635Crc(const dtypes::uint8* bufptr,int len){
+			static const dtypes::uint16 crcLookupTable[256] = {
+				0x00000,0x01189,0x02312,0x0329B,0x04624,0x057AD,0x06536,0x074BF,
+				0x08C48,0x09DC1,0x0AF5A,0x0BED3,0x0CA6C,0x0DBE5,0x0E97E,0x0F8F7,
+				0x01081,0x00108,0x03393,0x0221A,0x056A5,0x0472C,0x075B7,0x0643E,
+				0x09CC9,0x08D40,0x0BFDB,0x0AE52,0x0DAED,0x0CB64,0x0F9FF,0x0E876,
+				0x02102,0x0308B,0x00210,0x01399,0x06726,0x076AF,0x04434,0x055BD,
+				0x0AD4A,0x0BCC3,0x08E58,0x09FD1,0x0EB6E,0x0FAE7,0x0C87C,0x0D9F5,
+				0x03183,0x0200A,0x01291,0x00318,0x077A7,0x0662E,0x054B5,0x0453C,
+				0x0BDCB,0x0AC42,0x09ED9,0x08F50,0x0FBEF,0x0EA66,0x0D8FD,0x0C974,
+				0x04204,0x0538D,0x06116,0x0709F,0x00420,0x015A9,0x02732,0x036BB,
+				0x0CE4C,0x0DFC5,0x0ED5E,0x0FCD7,0x08868,0x099E1,0x0AB7A,0x0BAF3,
+				0x05285,0x0430C,0x07197,0x0601E,0x014A1,0x00528,0x037B3,0x0263A,
+				0x0DECD,0x0CF44,0x0FDDF,0x0EC56,0x098E9,0x08960,0x0BBFB,0x0AA72,
+				0x06306,0x0728F,0x04014,0x0519D,0x02522,0x034AB,0x00630,0x017B9,
+				0x0EF4E,0x0FEC7,0x0CC5C,0x0DDD5,0x0A96A,0x0B8E3,0x08A78,0x09BF1,
+				0x07387,0x0620E,0x05095,0x0411C,0x035A3,0x0242A,0x016B1,0x00738,
+				0x0FFCF,0x0EE46,0x0DCDD,0x0CD54,0x0B9EB,0x0A862,0x09AF9,0x08B70,
+				0x08408,0x09581,0x0A71A,0x0B693,0x0C22C,0x0D3A5,0x0E13E,0x0F0B7,
+				0x00840,0x019C9,0x02B52,0x03ADB,0x04E64,0x05FED,0x06D76,0x07CFF,
+				0x09489,0x08500,0x0B79B,0x0A612,0x0D2AD,0x0C324,0x0F1BF,0x0E036,
+				0x018C1,0x00948,0x03BD3,0x02A5A,0x05EE5,0x04F6C,0x07DF7,0x06C7E,
+				0x0A50A,0x0B483,0x08618,0x09791,0x0E32E,0x0F2A7,0x0C03C,0x0D1B5,
+				0x02942,0x038CB,0x00A50,0x01BD9,0x06F66,0x07EEF,0x04C74,0x05DFD,
+				0x0B58B,0x0A402,0x09699,0x08710,0x0F3AF,0x0E226,0x0D0BD,0x0C134,
+				0x039C3,0x0284A,0x01AD1,0x00B58,0x07FE7,0x06E6E,0x05CF5,0x04D7C,
+				0x0C60C,0x0D785,0x0E51E,0x0F497,0x08028,0x091A1,0x0A33A,0x0B2B3,
+				0x04A44,0x05BCD,0x06956,0x078DF,0x00C60,0x01DE9,0x02F72,0x03EFB,
+				0x0D68D,0x0C704,0x0F59F,0x0E416,0x090A9,0x08120,0x0B3BB,0x0A232,
+				0x05AC5,0x04B4C,0x079D7,0x0685E,0x01CE1,0x00D68,0x03FF3,0x02E7A,
+				0x0E70E,0x0F687,0x0C41C,0x0D595,0x0A12A,0x0B0A3,0x08238,0x093B1,
+				0x06B46,0x07ACF,0x04854,0x059DD,0x02D62,0x03CEB,0x00E70,0x01FF9,
+				0x0F78F,0x0E606,0x0D49D,0x0C514,0x0B1AB,0x0A022,0x092B9,0x08330,
+				0x07BC7,0x06A4E,0x058D5,0x0495C,0x03DE3,0x02C6A,0x01EF1,0x00F78
+			};
+
+			#if SDDS_ON_ARDUINO != 1
+				register
+			#endif
+			dtypes::uint16 newCrc=0xFFFF;
+			while(len--)
+				newCrc = (newCrc >> 8) ^ crcLookupTable[(newCrc ^ *bufptr++) & 0xff];
+			return(~newCrc);
+		}
+
+		/**
+		 * @brief detects streams with setTxReadyCallback(void(*)(void*), void*)
+		 *
+		 * Such a stream calls the callback when there is space in the transmit
+		 * buffer again after write() didn't take all bytes.
+		 */
+		template <class T>
+		class ThasTxReadyCallback{
+			template <class U>
+			static char test(decltype(static_cast<U*>(nullptr)->setTxReadyCallback(nullptr,nullptr))*);
+			template <class U>
+			static long test(...);
+			public:
+				constexpr static bool value = sizeof(test<T>(nullptr)) == 1;
+		};
+
+		/**
+		 * @brief installs the callback if the stream has one
+		 *
+		 * @return true if the stream reports free space
+		 */
+		template <class Tstream, bool hasCallback = ThasTxReadyCallback<Tstream>::value>
+		struct TtxReady{
+			static bool init(Tstream* _stream, void (*_callback)(void*), void* _arg){ return false; }
+		};
+
+		template <class Tstream>
+		struct TtxReady<Tstream,true>{
+			static bool init(Tstream* _stream, void (*_callback)(void*), void* _arg){
+				_stream->setTxReadyCallback(_callback,_arg);
+				return true;
+			}
+		};
+
+		/**
+		 * @tparam Tstream write(buf,n) returning the bytes taken, available(), read(),
+		 * optionally setTxReadyCallback, see ThasTxReadyCallback. Without it a
+		 * partially written packet is retried every ms.
+		 */
 		template <int nRows, int nColumns, class Tstream>
-		class TcrystalFontzCFA635 : public TabstractTextDisplay<nRows,nColumns>{
+		class TcrystalFontzCFA635 : public TabstractTextDisplay<nRows,nColumns,typename TdispatchTo<TcrystalFontzCFA635<nRows,nColumns,Tstream>>::type>{
+			template <int, int, class> friend class TabstractTextDisplay;
 			public:
 				//from crystalFontz datasheet
 				constexpr static int KEY_UP_PRESS        	= 1;
@@ -132,20 +223,34 @@ namespace sdds{
 				constexpr static int SDDS_TDS_KEY_ENTER 				= KEY_ENTER_PRESS;
 
 				TcrystalFontzCFA635(Tstream* _stream)
-					: TabstractTextDisplay<nRows,nColumns>()
+					: TabstractTextDisplay<nRows,nColumns,typename TdispatchTo<TcrystalFontzCFA635>::type>()
 				{
 					Fstream = _stream;
+					//type, length, 2 bytes crc and the position of PLACE_TEXT
+					this->FcommandOverhead = 6;
+					//CLS sets the cursor to 0;0, PLACE_TEXT doesn't touch it
+					this->FclearHomesCursor = true;
+					//special characters are 0..7
+					this->FglyphBase = 0;
+					this->Fcharset = Tcfa635Charset::table();
+					//ready once the display answers a ping, see begin
+					this->Fready = false;
+					Fkeys.setRepeatMask((1 << (KEY_UP_PRESS-1)) | (1 << (KEY_DOWN_PRESS-1)));
 
 					FreadTimer.start(100);
 					on(FreadTimer){ static_cast<TcrystalFontzCFA635*>(_self)->receive(); };
 					on(FwriteTimer){ static_cast<TcrystalFontzCFA635*>(_self)->transmit(); };
 					on(FresponseTimeout){ static_cast<TcrystalFontzCFA635*>(_self)->onResponseTimeout(); };
+					FtxReadyCallback = TtxReady<Tstream>::init(_stream,[](void* _self){
+						static_cast<TcrystalFontzCFA635*>(_self)->FwriteTimer.start(0);
+					},this);
 				}
 			private:
 				struct CMD{
 					constexpr static int PING 				= 0x00;
 					constexpr static int GET_VERSION 		= 0x01;
 					constexpr static int CLS	 			= 0x06;
+					constexpr static int SET_CHAR_DATA		= 0x09;
 					constexpr static int SET_CURSOR			= 0x0B;
 					constexpr static int SET_CURSOR_STYLE	= 0x0C;
 					constexpr static int PLACE_TEXT			= 0x1F;
@@ -161,7 +266,7 @@ namespace sdds{
 
 				dtypes::uint8 FtxBuffer[nColumns+16];
 				int FtxHead = 0;
-				int FtxTail;
+				int FtxTail = 0;
 
 				/* we need to be able to cache a whole message in case we need to resync */
 				TringBuffer<dtypes::uint8,2+MAX_RECV_PAYLOAD+2> FrxBuffer;
@@ -177,104 +282,134 @@ namespace sdds{
 					dtypes::uint8 getCmd(){ return (type>>6); };
 					dtypes::uint8 getType(){ return type; };				
 				} FrecPack;				
-				TringBuffer<dtypes::uint8,8> Fkeys;
+				//key index = press code - 1
+				TkeyRepeater<6,16> Fkeys;
 
 				dtypes::uint16 get_crc(dtypes::uint8* bufptr,int len){
-					static const dtypes::uint16 crcLookupTable[256] = {
-						0x00000,0x01189,0x02312,0x0329B,0x04624,0x057AD,0x06536,0x074BF,
-						0x08C48,0x09DC1,0x0AF5A,0x0BED3,0x0CA6C,0x0DBE5,0x0E97E,0x0F8F7,
-						0x01081,0x00108,0x03393,0x0221A,0x056A5,0x0472C,0x075B7,0x0643E,
-						0x09CC9,0x08D40,0x0BFDB,0x0AE52,0x0DAED,0x0CB64,0x0F9FF,0x0E876,
-						0x02102,0x0308B,0x00210,0x01399,0x06726,0x076AF,0x04434,0x055BD,
-						0x0AD4A,0x0BCC3,0x08E58,0x09FD1,0x0EB6E,0x0FAE7,0x0C87C,0x0D9F5,
-						0x03183,0x0200A,0x01291,0x00318,0x077A7,0x0662E,0x054B5,0x0453C,
-						0x0BDCB,0x0AC42,0x09ED9,0x08F50,0x0FBEF,0x0EA66,0x0D8FD,0x0C974,
-						0x04204,0x0538D,0x06116,0x0709F,0x00420,0x015A9,0x02732,0x036BB,
-						0x0CE4C,0x0DFC5,0x0ED5E,0x0FCD7,0x08868,0x099E1,0x0AB7A,0x0BAF3,
-						0x05285,0x0430C,0x07197,0x0601E,0x014A1,0x00528,0x037B3,0x0263A,
-						0x0DECD,0x0CF44,0x0FDDF,0x0EC56,0x098E9,0x08960,0x0BBFB,0x0AA72,
-						0x06306,0x0728F,0x04014,0x0519D,0x02522,0x034AB,0x00630,0x017B9,
-						0x0EF4E,0x0FEC7,0x0CC5C,0x0DDD5,0x0A96A,0x0B8E3,0x08A78,0x09BF1,
-						0x07387,0x0620E,0x05095,0x0411C,0x035A3,0x0242A,0x016B1,0x00738,
-						0x0FFCF,0x0EE46,0x0DCDD,0x0CD54,0x0B9EB,0x0A862,0x09AF9,0x08B70,
-						0x08408,0x09581,0x0A71A,0x0B693,0x0C22C,0x0D3A5,0x0E13E,0x0F0B7,
-						0x00840,0x019C9,0x02B52,0x03ADB,0x04E64,0x05FED,0x06D76,0x07CFF,
-						0x09489,0x08500,0x0B79B,0x0A612,0x0D2AD,0x0C324,0x0F1BF,0x0E036,
-						0x018C1,0x00948,0x03BD3,0x02A5A,0x05EE5,0x04F6C,0x07DF7,0x06C7E,
-						0x0A50A,0x0B483,0x08618,0x09791,0x0E32E,0x0F2A7,0x0C03C,0x0D1B5,
-						0x02942,0x038CB,0x00A50,0x01BD9,0x06F66,0x07EEF,0x04C74,0x05DFD,
-						0x0B58B,0x0A402,0x09699,0x08710,0x0F3AF,0x0E226,0x0D0BD,0x0C134,
-						0x039C3,0x0284A,0x01AD1,0x00B58,0x07FE7,0x06E6E,0x05CF5,0x04D7C,
-						0x0C60C,0x0D785,0x0E51E,0x0F497,0x08028,0x091A1,0x0A33A,0x0B2B3,
-						0x04A44,0x05BCD,0x06956,0x078DF,0x00C60,0x01DE9,0x02F72,0x03EFB,
-						0x0D68D,0x0C704,0x0F59F,0x0E416,0x090A9,0x08120,0x0B3BB,0x0A232,
-						0x05AC5,0x04B4C,0x079D7,0x0685E,0x01CE1,0x00D68,0x03FF3,0x02E7A,
-						0x0E70E,0x0F687,0x0C41C,0x0D595,0x0A12A,0x0B0A3,0x08238,0x093B1,
-						0x06B46,0x07ACF,0x04854,0x059DD,0x02D62,0x03CEB,0x00E70,0x01FF9,
-						0x0F78F,0x0E606,0x0D49D,0x0C514,0x0B1AB,0x0A022,0x092B9,0x08330,
-						0x07BC7,0x06A4E,0x058D5,0x0495C,0x03DE3,0x02C6A,0x01EF1,0x00F78
-					};
-
-					#if SDDS_ON_ARDUINO != 1
-						register
-					#endif
-					dtypes::uint16 newCrc=0xFFFF;
-					while(len--)
-						newCrc = (newCrc >> 8) ^ crcLookupTable[(newCrc ^ *bufptr++) & 0xff];
-					return(~newCrc);
+					return cfa635Crc(bufptr,len);
 				}
 
+				//command waiting for its answer, -1 if none
+				int FpendingCmd = -1;
+
 				void initSend(const dtypes::uint8 _type){
 					FtxBuffer[0] = _type;
 					FtxHead = 2;
+					FpendingCmd = _type;
 				}
 
 				void addData(dtypes::uint8 _data){
 					FtxBuffer[FtxHead++]=_data;
 				}
 				
+				//text has already been translated to the character ROM, see Tcfa635Charset
 				void addData( const dtypes::uint8* _data, int _len){
-					//memcpy(&FtxBuffer[FtxHead],_data,_len);
-					for (int i=0; i<_len; i++){
-						if (_data[i] == '_')
-							FtxBuffer[FtxHead+i] = 196;
-						else
-							FtxBuffer[FtxHead+i] = _data[i];
-					}
+					memcpy(&FtxBuffer[FtxHead],_data,_len);
 					FtxHead+=_len;
 				}
 
+				//stream tells when there is space again, no polling of write()
+				bool FtxReadyCallback = false;
+
 				void transmit(){
 					if (FtxTail >= FtxHead) return;
 					
 					int bytesToBeTrasmitted = FtxHead-FtxTail;
 					FtxTail+=Fstream->write(&FtxBuffer[FtxTail],bytesToBeTrasmitted);;
-					if (FtxTail < FtxHead)
-						FwriteTimer.setTimeEvent(1);
+					if (FtxTail < FtxHead){
+						if (!FtxReadyCallback) FwriteTimer.setTimeEvent(1);
+					}
 					else
 						FresponseTimeout.start(250);
 				}
 
+				constexpr static int PING_INTERVAL = 250;
+				constexpr static int MAX_PINGS = 8;	//then the display is used anyway, as after the former fixed delay
+				constexpr static int LOST_AFTER = 3;	//unanswered commands in a row
+				bool FpingPending = false;
+				int FpingCnt = 0;
+				int FmissedResponses = 0;
+				bool Freconnecting = false;
+				dtypes::uint8 FpingSeq = 0;
+
+				//the display echoes the number, so answers to earlier pings can be told apart
+				void sendPing(){
+					initSend(CMD::PING);
+					addData(++FpingSeq);
+					sendCmd();
+				}
+
 				int FretryCnt;
 				void onResponseTimeout(){
+					if (FpingPending){
+						if (Freconnecting || ++FpingCnt < MAX_PINGS) return sendPing();
+						return onPingAnswered();
+					}
 					if (FretryCnt++ >= 0){
-						handleResponse();
+						onCommandDone();
+						if (++FmissedResponses >= LOST_AFTER) onDisplayLost();
 						return;
 					}
 					FtxTail = 0;
 					transmit();
 				}
 
+				/**
+				 * @brief only the answer to the command in flight completes it
+				 *
+				 * Late answers to commands that have timed out (unanswered pings at power up,
+				 * pings repeated while reconnecting) would otherwise complete the next command
+				 * and every answer afterwards would belong to the wrong one. Nothing is answered
+				 * before the command has been sent completely.
+				 */
 				void handleResponse(){
+					if (FpendingCmd < 0 || (FrecPack.getType() & 0x3F) != FpendingCmd || FtxTail < FtxHead) return;
+					if (FpingPending){
+						//an answer left over from before the display was lost doesn't mean it is back
+						if (FrecPack.len == 1 && FrecPack.payload[0] == FpingSeq) onPingAnswered();
+						return;
+					}
+					FmissedResponses = 0;
+					onCommandDone();
+				}
+
+				void onCommandDone(){
+					FtxHead = 0;
+					FpendingCmd = -1;
+					FresponseTimeout.stop();
+					this->onTaskDone();
+				}
+
+				void onPingAnswered(){
 					FtxHead = 0;
+					FpendingCmd = -1;
 					FresponseTimeout.stop();
-					this->onTaskDone();				
+					FpingPending = false;
+					if (Freconnecting){
+						//power loss or hot plug, nothing on the screen can be trusted
+						Freconnecting = false;
+						this->invalidate();
+					}
+					this->setReady();
+				}
+
+				/**
+				 * @brief stop sending and ping until the display is back
+				 */
+				void onDisplayLost(){
+					FmissedResponses = 0;
+					Freconnecting = true;
+					FpingPending = true;
+					this->Fready = false;
+					sendPing();
 				}
 
 				void handleReport(){
 					//check for key reports
 					if (FrecPack.getType() == 0x80){
-						Fkeys.push(FrecPack.payload[0]);
+						auto code = FrecPack.payload[0];
+						if (code >= KEY_UP_RELEASE) Fkeys.release(code - KEY_UP_RELEASE, tdsMillis());
+						else Fkeys.press(code - KEY_UP_PRESS, tdsMillis());
 					}
 				}
 
@@ -362,8 +497,17 @@ namespace sdds{
 				}
 
 			public:
+				/**
+				 * @brief ping the display until it answers instead of waiting a fixed time after power up
+				 */
+				void begin(){
+					FpingPending = true;
+					FpingCnt = 0;
+					sendPing();
+				}
+
 				//"0x0B 0x02 0x00 0x00 0x73 0x89 " for 0,0
-				void doSetCursor(const TcursorInterface _cursor) override{ 
+				void doSetCursor(const TcursorInterface _cursor) SDDS_TDS_OVERRIDE{ 
 					initSend(CMD::SET_CURSOR);
 					addData(_cursor.x);
 					addData(_cursor.y);
@@ -371,17 +515,12 @@ namespace sdds{
 				}
 
 				//"0x06 0x00 0x97 0x5B "
-				void doClear() override{
+				void doClear() SDDS_TDS_OVERRIDE{
 					initSend(CMD::CLS);
 					sendCmd();
-					/**
-					 * CLS sets the cursor to 0;0 and therefore we have to update our local copy.
-					 */
-					this->FdisplayCursor.x = 0;
-					this->FdisplayCursor.y = 0;
 				}
 				
-				void doUpdateRow(TrowChanges _changes) override {
+				void doUpdateRow(TrowChanges _changes) SDDS_TDS_OVERRIDE{
 					initSend(CMD::PLACE_TEXT);
 					addData(_changes.firstChangedIdx);
 					addData(_changes.row);
@@ -389,10 +528,24 @@ namespace sdds{
 					sendCmd();
 				}
 
+				void doDefineGlyph(int _slot, const Tglyph& _glyph) SDDS_TDS_OVERRIDE{
+					initSend(CMD::SET_CHAR_DATA);
+					addData(_slot);
+					for (auto i = 0; i < Tglyph::N_ROWS; i++)
+						addData(_glyph.rows[i]);
+					sendCmd();
+				}
+
 				int readKey(){
-					return Fkeys.pop();
+					auto key = Fkeys.poll(tdsMillis());
+					return key >= 0 ? key + KEY_UP_PRESS : 0;
 				}
 
+				/**
+				 * @brief access to repeat settings and press/release timestamps of the keys
+				 */
+				TkeyRepeater<6,16>& keys(){ return Fkeys; }
+
 		};
 
 	}
@@ -0,0 +1,381 @@
+#ifndef UCRYSTALFONTZCFA635SIM_H
+#define UCRYSTALFONTZCFA635SIM_H
+
+#include "uCrystalFontzCFA635.h"
+#include <chrono>
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief host side emulation of a CFA635 connected through an UART
+		 *
+		 * Can be used as Tstream for TcrystalFontzCFA635 to run the driver on
+		 * Linux without hardware. Bytes travel in both directions with the timing
+		 * of a real 8N1 link at the configured baudrate. The host side transmit fifo
+		 * has the size of a typical UART driver buffer, so write() only accepts what
+		 * fits, just like Arduino's HardwareSerial does. Like an UART with a
+		 * transmit interrupt it reports free space with setTxReadyCallback,
+		 * checked whenever the driver accesses the stream.
+		 *
+		 * The display parses command packets, keeps a copy of the screen, answers
+		 * with correct responses (crc included) and sends key reports injected
+		 * with pressKey()/releaseKey(). Optionally bytes on the way to the display
+		 * can be corrupted or dropped to test the framing resync of the driver.
+		 *
+		 * usage:
+		 *	typedef TcrystalFontzCFA635Sim<4,20> Tsim;
+		 *	Tsim sim(115200);
+		 *	TcrystalFontzCFA635<4,20,Tsim> disp(&sim);
+		 *
+		 * @tparam TX_FIFO_SIZE size of the host side transmit buffer
+		 */
+		template <int nRows, int nColumns, int TX_FIFO_SIZE = 64>
+		class TcrystalFontzCFA635Sim{
+			public:
+				constexpr static int MAX_PAYLOAD = 22;
+				constexpr static int RX_FIFO_SIZE = 256;
+
+				struct Tstatistic{
+					dtypes::uint32 bytesToDisplay = 0;
+					dtypes::uint32 bytesFromDisplay = 0;
+					dtypes::uint32 packets = 0;
+					dtypes::uint32 crcErrors = 0;
+					dtypes::uint32 invalidPackets = 0;
+					dtypes::uint32 corruptedBytes = 0;
+					dtypes::uint32 droppedBytes = 0;
+					dtypes::uint32 txRejected = 0;		//bytes not accepted by write() because of a full fifo
+				};
+
+				TcrystalFontzCFA635Sim(dtypes::uint32 _baudrate = 115200){
+					setBaudrate(_baudrate);
+					for (auto row = 0; row < nRows; row++)
+						for (auto col = 0; col < nColumns; col++)
+							Fscreen[row][col] = ' ';
+					FlastUpdate = clock();
+				}
+
+				/*****************************************
+				 * Tstream interface
+				******************************************/
+
+				int write(const dtypes::uint8* _data, int _len){
+					update();
+					int n = 0;
+					while (n < _len && FtxFifo.push(_data[n])) n++;
+					Fstat.txRejected += _len - n;
+					if (n < _len) FtxBlocked = true;
+					return n;
+				}
+
+				int write(dtypes::uint8 _byte){ return write(&_byte,1); }
+
+				int available(){
+					update();
+					return FrxFifo.size();
+				}
+
+				int read(){
+					update();
+					dtypes::uint8 b;
+					if (!FrxFifo.pop(b)) return -1;
+					return b;
+				}
+
+				/**
+				 * @brief _callback(_arg) is called when the fifo has space again after a write() has been cut short
+				 */
+				void setTxReadyCallback(void (*_callback)(void*), void* _arg){
+					FtxReady = _callback;
+					FtxReadyArg = _arg;
+				}
+
+				/*****************************************
+				 * configuration
+				******************************************/
+
+				void setBaudrate(dtypes::uint32 _baudrate){
+					//8N1 -> 10 bits per byte
+					FusPerByte = 10000000UL / (_baudrate > 0 ? _baudrate : 1);
+					if (FusPerByte == 0) FusPerByte = 1;
+				}
+
+				/**
+				 * @brief corrupt/drop bytes on the way to the display
+				 *
+				 * @param _corruptPerMille probability a byte is modified
+				 * @param _dropPerMille probability a byte gets lost
+				 * @param _seed seed for the pseudo random generator to get reproducible runs
+				 */
+				void setFaults(int _corruptPerMille, int _dropPerMille, dtypes::uint32 _seed = 1){
+					FcorruptPerMille = _corruptPerMille;
+					FdropPerMille = _dropPerMille;
+					Frandom = _seed ? _seed : 1;
+				}
+
+				/**
+				 * @brief switch the display off and on again, e.g. to test the reconnect of the driver
+				 *
+				 * While off, bytes to the display are lost. It comes back blank and
+				 * without user defined characters.
+				 */
+				void setPower(bool _on){
+					update();
+					if (_on && !Fpowered){
+						for (auto row = 0; row < nRows; row++)
+							for (auto col = 0; col < nColumns; col++)
+								Fscreen[row][col] = ' ';
+						memset(Fglyphs,0,sizeof(Fglyphs));
+						Fcursor = TcursorInterface();
+						FpacketLen = 0;
+					}
+					Fpowered = _on;
+				}
+
+				/**
+				 * @brief use a virtual clock advanced by advanceTime() instead of the system clock
+				 *
+				 * Makes runs independent of the speed of the host.
+				 */
+				void useManualClock(bool _manual = true){
+					FmanualClock = _manual;
+					FlastUpdate = clock();
+				}
+
+				void advanceTime(dtypes::uint32 _us){
+					FmanualTime += _us;
+					update();
+				}
+
+				/*****************************************
+				 * keypad
+				******************************************/
+
+				void pressKey(dtypes::uint8 _pressCode){ sendPacket(0x80,&_pressCode,1); }
+
+				/**
+				 * @brief press and release codes differ by 6 according to the datasheet
+				 */
+				void releaseKey(dtypes::uint8 _pressCode){
+					dtypes::uint8 code = _pressCode + 6;
+					sendPacket(0x80,&code,1);
+				}
+
+				/*****************************************
+				 * access to the simulated display
+				******************************************/
+
+				char charAt(int _row, int _col) const { return Fscreen[_row][_col]; }
+				const char* row(int _row) const { return Fscreen[_row]; }
+				bool rowEquals(int _row, const char* _str) const { return strncmp(Fscreen[_row],_str,nColumns) == 0; }
+				TcursorInterface cursor() const { return Fcursor; }
+				int cursorStyle() const { return FcursorStyle; }
+				const dtypes::uint8* glyph(int _slot) const { return Fglyphs[_slot]; }
+				const Tstatistic& statistic() const { return Fstat; }
+				void resetStatistic(){ Fstat = Tstatistic(); }
+
+				/**
+				 * @brief true if nothing is on the wire or waiting in a fifo
+				 */
+				bool idle(){
+					update();
+					return FtxFifo.isEmpty() && FdevTx.isEmpty();
+				}
+
+			private:
+				dtypes::uint32 FusPerByte;
+				dtypes::uint32 FlastUpdate;
+				dtypes::uint32 FtxCredit = 0;		//us the line to the display has been busy
+				dtypes::uint32 FrxCredit = 0;		//us the line from the display has been busy
+				bool FmanualClock = false;
+				dtypes::uint32 FmanualTime = 0;
+
+				bool Fpowered = true;
+				int FcorruptPerMille = 0;
+				int FdropPerMille = 0;
+				dtypes::uint32 Frandom = 1;
+
+				TringBuffer<dtypes::uint8,TX_FIFO_SIZE> FtxFifo;	//host -> wire
+				bool FtxBlocked = false;
+				void (*FtxReady)(void*) = nullptr;
+				void* FtxReadyArg = nullptr;
+				TringBuffer<dtypes::uint8,RX_FIFO_SIZE> FdevTx;		//display -> wire
+				TringBuffer<dtypes::uint8,RX_FIFO_SIZE> FrxFifo;	//wire -> host
+
+				dtypes::uint8 Fpacket[2+MAX_PAYLOAD+2];
+				int FpacketLen = 0;
+
+				char Fscreen[nRows][nColumns];
+				TcursorInterface Fcursor;
+				int FcursorStyle = 0;
+				dtypes::uint8 Fglyphs[8][8] = {};
+				Tstatistic Fstat;
+
+				dtypes::uint32 clock(){
+					if (FmanualClock) return FmanualTime;
+					using namespace std::chrono;
+					return static_cast<dtypes::uint32>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+				}
+
+				dtypes::uint32 random(){
+					//xorshift32
+					Frandom ^= Frandom << 13;
+					Frandom ^= Frandom >> 17;
+					Frandom ^= Frandom << 5;
+					return Frandom;
+				}
+
+				/**
+				 * @brief move as many bytes over the wire as the baudrate allows since the last call
+				 */
+				void update(){
+					auto now = clock();
+					auto elapsed = now - FlastUpdate;
+					FlastUpdate = now;
+
+					FtxCredit += elapsed;
+					while (FtxCredit >= FusPerByte){
+						dtypes::uint8 b;
+						if (!FtxFifo.pop(b)){
+							FtxCredit = 0;
+							break;
+						}
+						FtxCredit -= FusPerByte;
+						Fstat.bytesToDisplay++;
+						if (!Fpowered){
+							Fstat.droppedBytes++;
+							continue;
+						}
+						if (FdropPerMille && int(random()%1000) < FdropPerMille){
+							Fstat.droppedBytes++;
+							continue;
+						}
+						if (FcorruptPerMille && int(random()%1000) < FcorruptPerMille){
+							b ^= 1 << (random()%8);
+							Fstat.corruptedBytes++;
+						}
+						receiveByte(b);
+					}
+					if (FtxBlocked && !FtxFifo.isFull()){
+						FtxBlocked = false;
+						if (FtxReady) FtxReady(FtxReadyArg);
+					}
+
+					FrxCredit += elapsed;
+					while (FrxCredit >= FusPerByte){
+						if (FdevTx.isEmpty() || FrxFifo.isFull()){
+							FrxCredit = 0;
+							break;
+						}
+						FrxCredit -= FusPerByte;
+						FrxFifo.push(FdevTx.pop());
+						Fstat.bytesFromDisplay++;
+					}
+				}
+
+				/*****************************************
+				 * display side
+				******************************************/
+
+				void sendPacket(dtypes::uint8 _type, const dtypes::uint8* _data, int _len){
+					dtypes::uint8 buf[2+MAX_PAYLOAD+2];
+					buf[0] = _type;
+					buf[1] = _len;
+					for (int i = 0; i < _len; i++) buf[2+i] = _data[i];
+					auto crc = cfa635Crc(buf,2+_len);
+					buf[2+_len] = crc & 0xFF;
+					buf[3+_len] = crc >> 8;
+					for (int i = 0; i < _len+4; i++) FdevTx.push(buf[i]);
+				}
+
+				void sendResponse(dtypes::uint8 _cmd, const dtypes::uint8* _data = nullptr, int _len = 0){
+					sendPacket(0x40 | _cmd, _data, _len);
+				}
+
+				void sendError(dtypes::uint8 _cmd){
+					Fstat.invalidPackets++;
+					sendPacket(0xC0 | _cmd, nullptr, 0);
+				}
+
+				/**
+				 * @brief discard the first byte of the current packet and rescan the remaining ones
+				 */
+				void resync(){
+					int n = FpacketLen-1;
+					dtypes::uint8 pending[2+MAX_PAYLOAD+2];
+					memcpy(pending,&Fpacket[1],n);
+					FpacketLen = 0;
+					for (int i = 0; i < n; i++) receiveByte(pending[i]);
+				}
+
+				void receiveByte(dtypes::uint8 _byte){
+					Fpacket[FpacketLen++] = _byte;
+					//commands only, bits 7:6 have to be 0
+					if (FpacketLen == 1 && (_byte & 0xC0) != 0){
+						FpacketLen = 0;
+						return;
+					}
+					if (FpacketLen == 2 && _byte > MAX_PAYLOAD) return resync();
+					if (FpacketLen < 4 || FpacketLen < Fpacket[1]+4) return;
+
+					int len = Fpacket[1];
+					dtypes::uint16 crc = Fpacket[2+len] + Fpacket[3+len]*256;
+					if (crc != cfa635Crc(Fpacket,2+len)){
+						Fstat.crcErrors++;
+						return resync();
+					}
+					FpacketLen = 0;
+					Fstat.packets++;
+					handleCommand(Fpacket[0], &Fpacket[2], len);
+				}
+
+				void handleCommand(dtypes::uint8 _cmd, const dtypes::uint8* _data, int _len){
+					switch(_cmd){
+						case 0x00:		//PING, echo data
+							return sendResponse(_cmd,_data,_len);
+
+						case 0x01:{		//GET_VERSION
+							const char* version = "CFA635:hSIM,vSIM";
+							return sendResponse(_cmd,reinterpret_cast<const dtypes::uint8*>(version),strlen(version));
+						}
+
+						case 0x06:		//CLS
+							for (auto row = 0; row < nRows; row++)
+								for (auto col = 0; col < nColumns; col++)
+									Fscreen[row][col] = ' ';
+							Fcursor.x = 0;
+							Fcursor.y = 0;
+							return sendResponse(_cmd);
+
+						case 0x09:		//SET_CHAR_DATA
+							if (_len != 9 || _data[0] > 7) return sendError(_cmd);
+							memcpy(Fglyphs[_data[0]],&_data[1],8);
+							return sendResponse(_cmd);
+
+						case 0x0B:		//SET_CURSOR
+							if (_len != 2 || _data[0] >= nColumns || _data[1] >= nRows) return sendError(_cmd);
+							Fcursor.x = _data[0];
+							Fcursor.y = _data[1];
+							return sendResponse(_cmd);
+
+						case 0x0C:		//SET_CURSOR_STYLE
+							if (_len != 1 || _data[0] > 4) return sendError(_cmd);
+							FcursorStyle = _data[0];
+							return sendResponse(_cmd);
+
+						case 0x1F:{		//PLACE_TEXT
+							if (_len < 3 || _data[0] >= nColumns || _data[1] >= nRows) return sendError(_cmd);
+							int col = _data[0];
+							for (int i = 2; i < _len && col < nColumns; i++)
+								Fscreen[_data[1]][col++] = _data[i];
+							return sendResponse(_cmd);
+						}
+					}
+					sendError(_cmd);
+				}
+		};
+
+	}
+}
+
+#endif //UCRYSTALFONTZCFA635SIM_H
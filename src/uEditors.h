@@ -8,56 +8,97 @@
 //#include <cstring>	//strlen	not available on some platforms (Arduino i.e. Uno)
 #include <string.h>		//strlen
 #include <new>			//required for AVR-GCC
+#include "uTdsConfig.h"
 
 namespace sdds{
 	namespace textDisplaySpike{
 		/**
 		 * @brief TeditorBase base class for all editors
+		 *
+		 * With SDDS_TDS_STATIC_DISPATCH the functions switch over the editors
+		 * created by TeditorContainer instead of using a vtable, see the end of the file.
 		 */
 		class TeditorBase{
+			friend class TeditorContainer;
 			protected:
 				int FdisplayWidth;    // width available for us
 				Tdescr* Fdescr;
 				bool FeditDone = false;
+				enum class Tkind : dtypes::uint8{ ENUM, UINT8, UINT16, UINT32, INT8, INT16, INT32, FLOAT32 };
+#if SDDS_TDS_STATIC_DISPATCH == 1
+				Tkind Fkind;
+#endif
 			public:
-				virtual void init(Tdescr* _descr, int _displayWidth){
+				SDDS_TDS_VIRTUAL void init(Tdescr* _descr, int _displayWidth) SDDS_TDS_ABSTRACT;
+
+				SDDS_TDS_VIRTUAL void keyLeft() SDDS_TDS_ABSTRACT;
+				SDDS_TDS_VIRTUAL void keyRight() SDDS_TDS_ABSTRACT;
+				SDDS_TDS_VIRTUAL void keyUp() SDDS_TDS_ABSTRACT;
+				SDDS_TDS_VIRTUAL void keyDown() SDDS_TDS_ABSTRACT;
+				SDDS_TDS_VIRTUAL void keyEnter() SDDS_TDS_ABSTRACT;
+				SDDS_TDS_VIRTUAL void keyEsc() SDDS_TDS_ABSTRACT;
+				SDDS_TDS_VIRTUAL int displayCursorPos() SDDS_TDS_ABSTRACT;
+				SDDS_TDS_VIRTUAL void getDisplayString(dtypes::string& _out) SDDS_TDS_ABSTRACT;
+				bool editDone(){ return FeditDone; }
+
+				/**
+				 * @brief characters changed since the last call, as positions from the right end of the value
+				 *
+				 * Editors that know which characters a key changed report them here,
+				 * so only these are written instead of the whole value. An empty span
+				 * (_low > _high) means only the cursor moved.
+				 *
+				 * @return false if the value has to be redrawn with getDisplayString
+				 */
+				SDDS_TDS_VIRTUAL bool takeChangedSpan(int& _low, int& _high) SDDS_TDS_ABSTRACT;
+
+				/**
+				 * @brief character at _pos from the right end, for the span of takeChangedSpan
+				 */
+				SDDS_TDS_VIRTUAL char displayChar(int _pos) SDDS_TDS_ABSTRACT;
+		};
+
+		/**
+		 * @brief defaults of the editors, editors derive from here
+		 */
+		class Teditor : public TeditorBase{
+			public:
+				void init(Tdescr* _descr, int _displayWidth) SDDS_TDS_OVERRIDE{
 					Fdescr = _descr;
 					FdisplayWidth = _displayWidth;
 				}
 
-				virtual void keyLeft() {}; 
-				virtual void keyRight() {}; 
-				virtual void keyUp() = 0; 
-				virtual void keyDown() = 0; 
-				virtual void keyEnter(){ }; 
-				virtual void keyEsc(){ FeditDone = true; }; 
-				virtual int displayCursorPos() = 0;
-				virtual void getDisplayString(dtypes::string& _out) = 0;
-				bool editDone(){ return FeditDone; }
+				void keyLeft() SDDS_TDS_OVERRIDE {};
+				void keyRight() SDDS_TDS_OVERRIDE {};
+				void keyEnter() SDDS_TDS_OVERRIDE { };
+				void keyEsc() SDDS_TDS_OVERRIDE { FeditDone = true; };
+				bool takeChangedSpan(int& _low, int& _high) SDDS_TDS_OVERRIDE { return false; }
+				char displayChar(int _pos) SDDS_TDS_OVERRIDE { return ' '; }
 		};
 
 		/**
 		 * @brief TenumEditor editor for enum types
 		 */
-		class TenumEditor : public TeditorBase{
-			void keyUp() override {
+		class TenumEditor : public Teditor{
+			friend class TeditorBase;
+			void keyUp() SDDS_TDS_OVERRIDE {
 				if (FordVal <= 0) return;
 				FordVal--;
 			}; 
 
-			void keyDown() override { 
+			void keyDown() SDDS_TDS_OVERRIDE { 
 				if (FordVal+1 >= FenCnt) return;
 				FordVal++;
 			}
 
-			void keyEnter() override {
+			void keyEnter() SDDS_TDS_OVERRIDE {
 				memcpy(Fdescr->pValue(),&FordVal,Fdescr->valSize()); 
 				Fdescr->signalEvents();
 			}
 
-			int displayCursorPos() override { return FdisplayWidth-1; }; 
+			int displayCursorPos() SDDS_TDS_OVERRIDE { return FdisplayWidth-1; }; 
 
-			void getDisplayString(dtypes::string& _out) override {
+			void getDisplayString(dtypes::string& _out) SDDS_TDS_OVERRIDE {
 				auto it = static_cast<TenumBase*>(Fdescr)->enumInfo().iterator;
 				const char* enStr = "";
 				for (dtypes::uint32 i=0;i<=FordVal;i++)
@@ -68,8 +109,8 @@ namespace sdds{
 			dtypes::uint32 FordVal;
 			dtypes::uint32 FenCnt;
 			public:
-				void init(Tdescr* _enum, int _dispWidth) override{
-					TeditorBase::init(_enum,_dispWidth);
+				void init(Tdescr* _enum, int _dispWidth) SDDS_TDS_OVERRIDE{
+					Teditor::init(_enum,_dispWidth);
 					FordVal = 0;
 					memcpy(&FordVal,_enum->pValue(),_enum->valSize());
 					FenCnt = 0;
@@ -91,34 +132,112 @@ namespace sdds{
 			return countDigits(dtypes::high<T>());
 		}
 
+		/**
+		 * @brief integer type of TintEditor at runtime
+		 *
+		 * The digit stepping works on the raw bits of the value in an uint32,
+		 * so it is shared by all integer types, see SDDS_TDS_SHARED_CORE.
+		 */
+		struct TintType{
+			dtypes::uint8 size;		//bytes
+			bool isSigned;
+
+			dtypes::uint32 mask() const { return size >= 4 ? ~dtypes::uint32(0) : (dtypes::uint32(1) << (8*size)) - 1; }
+			dtypes::uint32 signBit() const { return isSigned ? dtypes::uint32(1) << (8*size-1) : 0; }
+			bool negative(dtypes::uint32 _raw) const { return (_raw & signBit()) != 0; }
+		};
+
+		//magnitude for decimal, the bits for hex and binary
+		SDDS_TDS_SHARED dtypes::uint32 tdsIntDigits(dtypes::uint32 _raw, TintType _type, int _base){
+			if (_base == 10 && _type.negative(_raw)) return (dtypes::uint32(0) - _raw) & _type.mask();
+			return _raw;
+		}
+
+		SDDS_TDS_SHARED int tdsDigitCount(dtypes::uint32 _v, int _base){
+			int n = 1;
+			while (_v >= dtypes::uint32(_base)){
+				_v /= _base;
+				n++;
+			}
+			return n;
+		}
+
+		SDDS_TDS_SHARED char tdsDigitChar(dtypes::uint32 _digits, int _base, int _pos, char _hexCase){
+			while (_pos-- > 0) _digits /= _base;
+			int digit = _digits % _base;
+			return digit < 10 ? '0' + digit : _hexCase + digit - 10;
+		}
+
+		/**
+		 * @brief add or subtract _base^_pos, saturating at the limits of the type
+		 *
+		 * Works on the raw bits, so the weight of the sign bit in binary doesn't
+		 * overflow to the minimum of the type and flip the sign instead.
+		 */
+		SDDS_TDS_SHARED dtypes::uint32 tdsStepDigit(dtypes::uint32 _raw, TintType _type, int _base, int _pos, bool _up){
+			dtypes::uint32 weight = 1;
+			while (_pos-- > 0) weight *= _base;
+			//biased, so the limits are 0 and mask for signed types as well
+			auto biased = (_raw ^ _type.signBit()) & _type.mask();
+			if (_up) biased = weight <= _type.mask() - biased ? biased + weight : _type.mask();
+			else biased = weight <= biased ? biased - weight : 0;
+			return (biased ^ _type.signBit()) & _type.mask();
+		}
+
+		/**
+		 * @brief widen the span _low.._high by the digits that differ between _old and _new
+		 *
+		 * A different sign or number of digits moves the whole value.
+		 *
+		 * @return false if the value has to be redrawn
+		 */
+		SDDS_TDS_SHARED bool tdsChangedDigits(dtypes::uint32 _old, dtypes::uint32 _new, TintType _type, int _base, char _hexCase, int& _low, int& _high){
+			if (_type.negative(_old) != _type.negative(_new)) return false;
+			auto o = tdsIntDigits(_old,_type,_base);
+			auto n = tdsIntDigits(_new,_type,_base);
+			if (tdsDigitCount(o,_base) != tdsDigitCount(n,_base)) return false;
+			for (auto pos = 0; o != n; pos++, o /= _base, n /= _base){
+				if (o % _base == n % _base) continue;
+				if (n % _base >= 10 && !_hexCase) return false;
+				if (_low > _high) _low = _high = pos;
+				else if (pos < _low) _low = pos;
+				else if (pos > _high) _high = pos;
+			}
+			return true;
+		}
+
 		/**
 		 * @brief TintEditor Editor for integer Types
 		 * 
 		 * @tparam TdescrType
 		 */
 		template <class TdescrType>
-		class TintEditor : public TeditorBase{
+		class TintEditor : public Teditor{
+			friend class TeditorBase;
 
 			typedef typename TdescrType::dtype TworkInteger;
 			constexpr static auto MAX_VALUE = dtypes::high<TworkInteger>();
 			constexpr static auto MIN_VALUE = dtypes::low<TworkInteger>();
 			constexpr static auto MAX_DIGITS = maxDecimalDigits<TworkInteger>();
 
-			void keyLeft() override { moveCursorLeft(); }; 
-			void keyRight() override { moveCursorRight(); }; 
-			void keyUp() override { increaseDigit(); }; 
-			void keyDown() override { decreaseDigit(); }; 
-			void keyEnter() override{
+			void keyLeft() SDDS_TDS_OVERRIDE { moveCursorLeft(); }; 
+			void keyRight() SDDS_TDS_OVERRIDE { moveCursorRight(); }; 
+			void keyUp() SDDS_TDS_OVERRIDE { increaseDigit(); }; 
+			void keyDown() SDDS_TDS_OVERRIDE { decreaseDigit(); }; 
+			void keyEnter() SDDS_TDS_OVERRIDE{
 				*static_cast<TdescrType*>(Fdescr) = Fint;
 			}
 			
-			int displayCursorPos() override{
+			int displayCursorPos() SDDS_TDS_OVERRIDE{
 				return FdisplayWidth - FcursorPos - 1;
 			};
 
-			void getDisplayString(dtypes::string& _out) override{
-				if (Fdescr->showOption() == sdds::opt::showHex)
-					return sdds::to_string_hex(_out,&Fint,sizeof(Fint));
+			void getDisplayString(dtypes::string& _out) SDDS_TDS_OVERRIDE{
+				if (Fdescr->showOption() == sdds::opt::showHex){
+					sdds::to_string_hex(_out,&Fint,sizeof(Fint));
+					learnHexCase(_out);
+					return;
+				}
 				else if (Fdescr->showOption() == sdds::opt::showBin)
 					return sdds::to_string_bin(_out,&Fint,sizeof(Fint));
 				else{
@@ -128,16 +247,40 @@ namespace sdds{
 				//return "";
 			};
 
+			bool takeChangedSpan(int& _low, int& _high) SDDS_TDS_OVERRIDE{
+				auto redraw = FredrawAll;
+				_low = FspanLow;
+				_high = FspanHigh;
+				FredrawAll = false;
+				FspanLow = 0;
+				FspanHigh = -1;
+				return !redraw;
+			}
+
+			char displayChar(int _pos) SDDS_TDS_OVERRIDE{
+				auto base = digitBase();
+				return tdsDigitChar(tdsIntDigits(raw(Fint),intType(),base),base,_pos,FhexCase);
+			}
+
+			constexpr static bool INTEGRAL = TworkInteger(1)/2 == 0;
+
 			TworkInteger Fint;
 			int FcursorPos = 0;
 			int FmaxCursorPos;
 
+			//characters changed since takeChangedSpan, the first key redraws the value shown before editing
+			bool FredrawAll = true;
+			int FspanLow = 0;
+			int FspanHigh = -1;
+			char FhexCase = 0;		//'a' or 'A' once seen in a formatted value
+
 			public:
-				void init(Tdescr* _d, const int _displayWith) override{
-					TeditorBase::init(_d,_displayWith);
+				void init(Tdescr* _d, const int _displayWith) SDDS_TDS_OVERRIDE{
+					Teditor::init(_d,_displayWith);
 					FdisplayWidth = _displayWith;
 					Fdescr = _d;
 					Fint = *static_cast<TdescrType*>(_d);
+					FredrawAll = true;
 					if (Fdescr->showOption() == sdds::opt::showHex)
 						FmaxCursorPos = Fdescr->valSize()*2-1;
 					else if (Fdescr->showOption() == sdds::opt::showBin)
@@ -147,6 +290,36 @@ namespace sdds{
 				}
 
 			private:
+				int digitBase(){
+					switch(Fdescr->showOption()){
+						case sdds::opt::showHex: return 16;
+						case sdds::opt::showBin: return 2;
+					}
+					return 10;
+				}
+
+				static TintType intType(){ return TintType{sizeof(TworkInteger),MIN_VALUE < 0}; }
+
+				static dtypes::uint32 raw(TworkInteger _v){ return static_cast<dtypes::uint32>(_v) & intType().mask(); }
+
+				void learnHexCase(const dtypes::string& _str){
+					for (auto c : _str){
+						if (c >= 'a' && c <= 'f') FhexCase = 'a';
+						else if (c >= 'A' && c <= 'F') FhexCase = 'A';
+					}
+				}
+
+				/**
+				 * @brief collect the digits that differ from _old
+				 *
+				 * Floats are redrawn, their digits aren't weights of the cursor position.
+				 */
+				void trackChange(TworkInteger _old){
+					if (FredrawAll || _old == Fint) return;
+					if (!INTEGRAL || !tdsChangedDigits(raw(_old),raw(Fint),intType(),digitBase(),FhexCase,FspanLow,FspanHigh))
+						FredrawAll = true;
+				}
+
 				TworkInteger getWeight(){
 					switch(Fdescr->showOption()){
 						case sdds::opt::showHex:
@@ -157,21 +330,20 @@ namespace sdds{
 					return static_cast<TworkInteger>(mmath::pow(10, FcursorPos));
 				}
 
-				void increaseDigit() {
-					if (Fint <= MAX_VALUE - getWeight()) {
-        				Fint += getWeight();
-					} else {
-						Fint = MAX_VALUE;
-					}
+				void stepDigit(bool _up){
+					auto old = Fint;
+					if (INTEGRAL)
+						Fint = static_cast<TworkInteger>(tdsStepDigit(raw(Fint),intType(),digitBase(),FcursorPos,_up));
+					else if (_up)
+						Fint = Fint <= MAX_VALUE - getWeight() ? Fint + getWeight() : MAX_VALUE;
+					else
+						Fint = Fint >= MIN_VALUE + getWeight() ? Fint - getWeight() : MIN_VALUE;
+					trackChange(old);
 				}
 
-				void decreaseDigit() {
-					if (Fint >= MIN_VALUE + getWeight()) {
-        				Fint -= getWeight();
-					} else {
-						Fint = MIN_VALUE;
-					}
-				}
+				void increaseDigit() { stepDigit(true); }
+
+				void decreaseDigit() { stepDigit(false); }
 
 				void moveCursorLeft() {
 					if (FcursorPos < FmaxCursorPos)
@@ -185,21 +357,21 @@ namespace sdds{
 
 		};
 
-		class TtimeEditor : public TeditorBase{
+		class TtimeEditor : public Teditor{
 			int FcursorPos = 0;
 			int FsecInc = 1;
 			int FuSecInc = 0;
 			Ttime::dtype Ftime;
 
-			void keyLeft() override { moveCursorLeft(); }; 
-			void keyRight() override { moveCursorRight(); }; 
-			void keyUp() override { increaseDigit(); }; 
-			void keyDown() override { decreaseDigit(); }; 
-			void keyEnter() override{
+			void keyLeft() SDDS_TDS_OVERRIDE { moveCursorLeft(); }; 
+			void keyRight() SDDS_TDS_OVERRIDE { moveCursorRight(); }; 
+			void keyUp() SDDS_TDS_OVERRIDE { increaseDigit(); }; 
+			void keyDown() SDDS_TDS_OVERRIDE { decreaseDigit(); }; 
+			void keyEnter() SDDS_TDS_OVERRIDE{
 				*static_cast<Ttime*>(Fdescr) = Ftime;
 			}
 			
-			int displayCursorPos() override{
+			int displayCursorPos() SDDS_TDS_OVERRIDE{
 				auto cp = FcursorPos + FcursorPos/2;
 				return FdisplayWidth - cp - 1;
 			};
@@ -252,13 +424,13 @@ namespace sdds{
 				Ftime.tv_usec -= FuSecInc;
 			}
 
-			void getDisplayString(dtypes::string& _out) override{
+			void getDisplayString(dtypes::string& _out) SDDS_TDS_OVERRIDE{
 				sdds::to_string(_out,*static_cast<Ttime*>(Fdescr),Ftime);
 			};
 
 			public:
-				void init(Tdescr* _d, int _dispWidth) override{
-					TeditorBase::init(_d,_dispWidth);
+				void init(Tdescr* _d, int _dispWidth) SDDS_TDS_OVERRIDE{
+					Teditor::init(_d,_dispWidth);
 					Ftime = *static_cast<Ttime*>(_d);
 				}
 		};
@@ -285,6 +457,18 @@ namespace sdds{
 				};
 				Tcontainer Fcontainer;
 				TeditorBase* Finstance = nullptr;
+
+#if SDDS_TDS_STATIC_DISPATCH == 1
+				template <class Tconcrete>
+				static TeditorBase* make(Tconcrete& _mem, TeditorBase::Tkind _kind){
+					auto editor = new (&_mem) Tconcrete;
+					editor->Fkind = _kind;
+					return editor;
+				}
+#else
+				template <class Tconcrete>
+				static TeditorBase* make(Tconcrete& _mem, TeditorBase::Tkind){ return new (&_mem) Tconcrete; }
+#endif
 			public:
 				TeditorBase* getInstance(){ return Finstance; }
 				void destroy(){
@@ -299,21 +483,21 @@ namespace sdds{
 
 					auto t = _d->type();
 					if (t == sdds::Ttype::INT8) 
-						Finstance = new (&Fcontainer.Fint8Editor) TintEditor<Tint8>;
+						Finstance = make(Fcontainer.Fint8Editor,TeditorBase::Tkind::INT8);
 					else if (t == sdds::Ttype::INT16) 
-						Finstance = new (&Fcontainer.Fint16Editor) TintEditor<Tint16>;
+						Finstance = make(Fcontainer.Fint16Editor,TeditorBase::Tkind::INT16);
 					else if (t == sdds::Ttype::INT32) 
-						Finstance = new (&Fcontainer.Fint32Editor) TintEditor<Tint32>;
+						Finstance = make(Fcontainer.Fint32Editor,TeditorBase::Tkind::INT32);
 					else if (t == sdds::Ttype::UINT8) 
-						Finstance = new (&Fcontainer.Fuint8Editor) TintEditor<Tuint8>;
+						Finstance = make(Fcontainer.Fuint8Editor,TeditorBase::Tkind::UINT8);
 					else if (t == sdds::Ttype::UINT16) 
-						Finstance = new (&Fcontainer.Fuint16Editor) TintEditor<Tuint16>;
+						Finstance = make(Fcontainer.Fuint16Editor,TeditorBase::Tkind::UINT16);
 					else if (t == sdds::Ttype::UINT32) 
-						Finstance = new (&Fcontainer.Fuint32Editor) TintEditor<Tuint32>;
+						Finstance = make(Fcontainer.Fuint32Editor,TeditorBase::Tkind::UINT32);
 					else if (t == sdds::Ttype::ENUM) 
-						Finstance = new (&Fcontainer.FenumEditor) TenumEditor;
+						Finstance = make(Fcontainer.FenumEditor,TeditorBase::Tkind::ENUM);
 					else if (t == sdds::Ttype::FLOAT32) 
-						Finstance = new (&Fcontainer.Ffloat32Editor) TintEditor<Tfloat32>;
+						Finstance = make(Fcontainer.Ffloat32Editor,TeditorBase::Tkind::FLOAT32);
 					else
 						return nullptr;
 					
@@ -322,6 +506,37 @@ namespace sdds{
 				}
 		};
 
+#if SDDS_TDS_STATIC_DISPATCH == 1
+		/**
+		 * @brief static dispatch of TeditorBase to the editors of TeditorContainer
+		 */
+		#define SDDS_TDS_EDITOR_DISPATCH(_call) \
+			switch (Fkind){ \
+				case Tkind::ENUM: return static_cast<TenumEditor*>(this)->_call; \
+				case Tkind::UINT8: return static_cast<TintEditor<Tuint8>*>(this)->_call; \
+				case Tkind::UINT16: return static_cast<TintEditor<Tuint16>*>(this)->_call; \
+				case Tkind::UINT32: return static_cast<TintEditor<Tuint32>*>(this)->_call; \
+				case Tkind::INT8: return static_cast<TintEditor<Tint8>*>(this)->_call; \
+				case Tkind::INT16: return static_cast<TintEditor<Tint16>*>(this)->_call; \
+				case Tkind::INT32: return static_cast<TintEditor<Tint32>*>(this)->_call; \
+				case Tkind::FLOAT32: return static_cast<TintEditor<Tfloat32>*>(this)->_call; \
+			}
+
+		inline void TeditorBase::init(Tdescr* _descr, int _displayWidth){ SDDS_TDS_EDITOR_DISPATCH(init(_descr,_displayWidth)); }
+		inline void TeditorBase::keyLeft(){ SDDS_TDS_EDITOR_DISPATCH(keyLeft()); }
+		inline void TeditorBase::keyRight(){ SDDS_TDS_EDITOR_DISPATCH(keyRight()); }
+		inline void TeditorBase::keyUp(){ SDDS_TDS_EDITOR_DISPATCH(keyUp()); }
+		inline void TeditorBase::keyDown(){ SDDS_TDS_EDITOR_DISPATCH(keyDown()); }
+		inline void TeditorBase::keyEnter(){ SDDS_TDS_EDITOR_DISPATCH(keyEnter()); }
+		inline void TeditorBase::keyEsc(){ SDDS_TDS_EDITOR_DISPATCH(keyEsc()); }
+		inline int TeditorBase::displayCursorPos(){ SDDS_TDS_EDITOR_DISPATCH(displayCursorPos()); return 0; }
+		inline void TeditorBase::getDisplayString(dtypes::string& _out){ SDDS_TDS_EDITOR_DISPATCH(getDisplayString(_out)); }
+		inline bool TeditorBase::takeChangedSpan(int& _low, int& _high){ SDDS_TDS_EDITOR_DISPATCH(takeChangedSpan(_low,_high)); return false; }
+		inline char TeditorBase::displayChar(int _pos){ SDDS_TDS_EDITOR_DISPATCH(displayChar(_pos)); return ' '; }
+
+		#undef SDDS_TDS_EDITOR_DISPATCH
+#endif
+
 	}	
 }
 
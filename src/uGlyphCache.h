@@ -0,0 +1,104 @@
+#ifndef UGLYPHCACHE_H
+#define UGLYPHCACHE_H
+
+#include "uTypedef.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief user defined character, 8 rows of 5 pixels, bit 4 is the left column
+		 */
+		struct Tglyph{
+			constexpr static int N_ROWS = 8;
+			dtypes::uint8 rows[N_ROWS];
+		};
+
+		/**
+		 * @brief keeps track of the glyphs resident in the character generator RAM
+		 *
+		 * Identical bitmaps share a slot. If all slots are occupied, the least
+		 * recently used slot that isn't on the screen anymore is replaced. Slots
+		 * that have to be uploaded are marked pending until the display has sent
+		 * them.
+		 */
+		template <int N_SLOTS = 8>
+		class TglyphCache{
+			static_assert(N_SLOTS <= 8, "pending slots are tracked in 8 bit");
+			public:
+				/**
+				 * @brief slot holding _glyph, loaded if necessary
+				 *
+				 * @param _onScreen _onScreen(slot) returns true if the slot is still displayed and must not be replaced
+				 * @return slot or -1 if all slots are displayed
+				 */
+				template <class TonScreen>
+				int acquire(const Tglyph& _glyph, TonScreen _onScreen){
+					for (auto i = 0; i < N_SLOTS; i++){
+						auto& slot = Fslots[i];
+						if (slot.used && memcmp(slot.glyph.rows,_glyph.rows,Tglyph::N_ROWS) == 0){
+							slot.lastUse = ++Fclock;
+							return i;
+						}
+					}
+
+					int victim = -1;
+					for (auto i = 0; i < N_SLOTS; i++){
+						if (!Fslots[i].used){
+							victim = i;
+							break;
+						}
+						if (victim >= 0 && dtypes::int16(Fslots[i].lastUse - Fslots[victim].lastUse) >= 0) continue;
+						if (!_onScreen(i)) victim = i;
+					}
+					if (victim < 0) return -1;
+
+					auto& slot = Fslots[victim];
+					slot.glyph = _glyph;
+					slot.used = true;
+					slot.lastUse = ++Fclock;
+					FpendingMask |= 1 << victim;
+					return victim;
+				}
+
+				bool pending() const { return FpendingMask != 0; }
+
+				/**
+				 * @brief next slot to be uploaded, it isn't pending anymore afterwards
+				 *
+				 * @return slot or -1 if nothing is pending
+				 */
+				int takePending(){
+					for (auto i = 0; i < N_SLOTS; i++){
+						if (!(FpendingMask & (1 << i))) continue;
+						FpendingMask &= ~(1 << i);
+						return i;
+					}
+					return -1;
+				}
+
+				const Tglyph& glyph(int _slot) const { return Fslots[_slot].glyph; }
+
+				/**
+				 * @brief upload all loaded glyphs again, e.g. after the display has been reset
+				 */
+				void invalidate(){
+					for (auto i = 0; i < N_SLOTS; i++)
+						if (Fslots[i].used) FpendingMask |= 1 << i;
+				}
+
+			private:
+				struct Tslot{
+					Tglyph glyph;
+					dtypes::uint16 lastUse = 0;
+					bool used = false;
+				};
+				Tslot Fslots[N_SLOTS];
+				dtypes::uint16 Fclock = 0;
+				dtypes::uint8 FpendingMask = 0;
+		};
+
+	}
+}
+
+#endif //UGLYPHCACHE_H
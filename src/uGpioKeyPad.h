@@ -0,0 +1,109 @@
+#ifndef UGPIOKEYPAD_H
+#define UGPIOKEYPAD_H
+
+#include <Arduino.h>		//pinMode, attachInterrupt
+#include "uTdsMillis.h"
+#include "uKeyRepeat.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+		/**
+		 * @brief keys connected to GPIOs, pressed keys read high
+		 *
+		 * Pin changes are accepted after they have been stable for FdebounceTime.
+		 * UP and DOWN repeat while held, see TkeyRepeater.
+		 *
+		 * If all pins support interrupts, useInterrupts() lets the pins only be
+		 * sampled after a pin change until they are stable again instead of on
+		 * every call of readKey.
+		 */
+		template <int LEFT, int RIGHT, int UP, int DOWN, int ENTER, int ESCAPE>
+		class TgpioKeyPad{
+			public:
+				constexpr static int SDDS_TDS_KEY_LEFT = 75;
+				constexpr static int SDDS_TDS_KEY_RIGHT = 77;
+				constexpr static int SDDS_TDS_KEY_UP = 72;
+				constexpr static int SDDS_TDS_KEY_DOWN = 80;
+				constexpr static int SDDS_TDS_KEY_ESC = 27;
+				constexpr static int SDDS_TDS_KEY_ENTER = 13;
+
+				constexpr static int N_KEYS = 6;
+
+				dtypes::uint16 FdebounceTime = 20;
+				TkeyRepeater<N_KEYS> Frepeater;
+
+				void setupKeys(){
+					for (auto i = 0; i < N_KEYS; i++)
+						pinMode(pin(i),INPUT);
+					Frepeater.setRepeatMask((1 << 2) | (1 << 3));
+				}
+
+				/**
+				 * @brief sample the pins only after pin changes
+				 *
+				 * @return false if not all pins support interrupts, the keypad keeps polling then
+				 */
+				bool useInterrupts(){
+					for (auto i = 0; i < N_KEYS; i++)
+						if (digitalPinToInterrupt(pin(i)) == NOT_AN_INTERRUPT) return false;
+					for (auto i = 0; i < N_KEYS; i++)
+						attachInterrupt(digitalPinToInterrupt(pin(i)),onPinChange,CHANGE);
+					FuseInterrupts = true;
+					FpinChanged = true;
+					return true;
+				}
+
+				static void onPinChange(){ FpinChanged = true; }
+
+				int readKey(){
+					auto now = tdsMillis();
+					if (!FuseInterrupts || FpinChanged || FunstableMask){
+						FpinChanged = false;
+						sampleKeys(now);
+					}
+
+					static const int codes[N_KEYS] = {
+						SDDS_TDS_KEY_LEFT, SDDS_TDS_KEY_RIGHT, SDDS_TDS_KEY_UP,
+						SDDS_TDS_KEY_DOWN, SDDS_TDS_KEY_ENTER, SDDS_TDS_KEY_ESC
+					};
+					auto key = Frepeater.poll(now);
+					return key >= 0 ? codes[key] : 0;
+				}
+
+			private:
+				static volatile bool FpinChanged;
+				bool FuseInterrupts = false;
+				dtypes::uint8 FrawMask = 0;
+				dtypes::uint8 FunstableMask = 0;
+				dtypes::uint32 FchangedAt[N_KEYS] = {};
+
+				static int pin(int _keyIdx){
+					static const int pins[N_KEYS] = {LEFT,RIGHT,UP,DOWN,ENTER,ESCAPE};
+					return pins[_keyIdx];
+				}
+
+				void sampleKeys(dtypes::uint32 _now){
+					for (auto i = 0; i < N_KEYS; i++){
+						dtypes::uint8 bit = 1 << i;
+						bool raw = digitalRead(pin(i));
+						if (raw != bool(FrawMask & bit)){
+							FrawMask ^= bit;
+							FchangedAt[i] = _now;
+							FunstableMask |= bit;
+						}
+						if (!(FunstableMask & bit) || _now - FchangedAt[i] < FdebounceTime) continue;
+
+						FunstableMask &= ~bit;
+						if (raw) Frepeater.press(i,FchangedAt[i]);
+						else Frepeater.release(i,FchangedAt[i]);
+					}
+				}
+		};
+
+		template <int LEFT, int RIGHT, int UP, int DOWN, int ENTER, int ESCAPE>
+		volatile bool TgpioKeyPad<LEFT,RIGHT,UP,DOWN,ENTER,ESCAPE>::FpinChanged = false;
+
+	}
+}
+
+#endif //UGPIOKEYPAD_H
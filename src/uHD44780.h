@@ -0,0 +1,393 @@
+#ifndef UHD44780_H
+#define UHD44780_H
+
+#include "uAbstractTextDisplay.h"
+
+#include <assert.h>
+
+#if SDDS_ON_ARDUINO != 1
+	#include <vector>
+#endif
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief command set of HD44780 compatible controllers
+		 */
+		struct Thd44780Cmd{
+			constexpr static dtypes::uint8 CLEAR			= 0x01;
+			constexpr static dtypes::uint8 HOME				= 0x02;
+			constexpr static dtypes::uint8 ENTRY_MODE		= 0x04;
+			constexpr static dtypes::uint8 DISPLAY_CONTROL	= 0x08;
+			constexpr static dtypes::uint8 FUNCTION_SET		= 0x20;
+			constexpr static dtypes::uint8 SET_CGRAM		= 0x40;
+			constexpr static dtypes::uint8 SET_DDRAM		= 0x80;
+
+			//flags
+			constexpr static dtypes::uint8 ENTRY_INCREMENT	= 0x02;
+			constexpr static dtypes::uint8 DISPLAY_ON		= 0x04;
+			constexpr static dtypes::uint8 CURSOR_ON		= 0x02;
+			constexpr static dtypes::uint8 BLINK_ON			= 0x01;
+			constexpr static dtypes::uint8 TWO_LINES		= 0x08;
+
+			constexpr static int EXEC_TIME_US = 40;		//37us for most commands
+			constexpr static int CLEAR_TIME_MS = 2;		//1.52ms for clear/home
+
+			constexpr static dtypes::uint8 ddramAddr(int _col, int _row, int _nColumns){
+				return SET_DDRAM | (((_row & 1) ? 0x40 : 0x00) + ((_row & 2) ? _nColumns : 0) + _col);
+			}
+		};
+
+		/**
+		 * @brief one byte (or init nibble) to be sent to the controller
+		 */
+		struct Thd44780Op{
+			constexpr static dtypes::uint8 RS 		= 0x01;		//data register instead of instruction register
+			constexpr static dtypes::uint8 NIBBLE	= 0x02;		//only the high nibble, used during initialization
+			constexpr static int WAIT_SHIFT			= 4;		//ms to wait after this op in the upper 4 bits
+
+			dtypes::uint8 data;
+			dtypes::uint8 flags;
+
+			bool isData() const { return flags & RS; }
+			bool isNibble() const { return flags & NIBBLE; }
+			int waitMs() const { return flags >> WAIT_SHIFT; }
+		};
+
+		/**
+		 * @brief for displays without keys
+		 */
+		class TnoKeyPad{
+			public:
+				constexpr static int SDDS_TDS_KEY_LEFT = 75;
+				constexpr static int SDDS_TDS_KEY_RIGHT = 77;
+				constexpr static int SDDS_TDS_KEY_UP = 72;
+				constexpr static int SDDS_TDS_KEY_DOWN = 80;
+				constexpr static int SDDS_TDS_KEY_ESC = 27;
+				constexpr static int SDDS_TDS_KEY_ENTER = 13;
+
+				void setupKeys(){}
+				int readKey(){ return 0; }
+		};
+
+		/*****************************************
+		 * GPIO layer
+		 *
+		 * setOutput(pin), setInput(pin), write(pin,level), read(pin), delayUs(us)
+		******************************************/
+
+#if SDDS_ON_ARDUINO == 1
+		class TarduinoGpio{
+			public:
+				void setOutput(int _pin){ pinMode(_pin,OUTPUT); }
+				void setInput(int _pin){ pinMode(_pin,INPUT); }
+				void write(int _pin, bool _level){ digitalWrite(_pin,_level ? HIGH : LOW); }
+				bool read(int _pin){ return digitalRead(_pin); }
+				void delayUs(unsigned int _us){ delayMicroseconds(_us); }
+		};
+#else
+		/**
+		 * @brief records the traffic on the bus instead of driving pins
+		 *
+		 * Every falling edge of EN is recorded as strobe (rs<<4 | nibble). Bytes
+		 * are two consecutive strobes after the initialization. The recorder has to
+		 * know the wiring, call setPins with the pins of the transport before begin().
+		 */
+		class TgpioRecorder{
+			public:
+				struct Tpins{ int rs = -1; int en = -1; int d[4] = {-1,-1,-1,-1}; int rw = -1; };
+
+				std::vector<dtypes::uint8> strobes;
+				dtypes::uint32 pinWrites = 0;
+				dtypes::uint32 delayedUs = 0;
+				bool busyFlag = false;
+
+				void setPins(int _rs, int _en, int _d4, int _d5, int _d6, int _d7, int _rw){
+					Fpins.rs = _rs; Fpins.en = _en; Fpins.rw = _rw;
+					Fpins.d[0] = _d4; Fpins.d[1] = _d5; Fpins.d[2] = _d6; Fpins.d[3] = _d7;
+				}
+
+				void setOutput(int _pin){ }
+				void setInput(int _pin){ }
+				void write(int _pin, bool _level){
+					pinWrites++;
+					if (_pin < 0 || _pin >= MAX_PINS) return;
+					bool strobe = (_pin == Fpins.en) && Flevel[_pin] && !_level && !Flevel[Fpins.rw >= 0 ? Fpins.rw : MAX_PINS-1];
+					Flevel[_pin] = _level;
+					if (!strobe) return;
+					dtypes::uint8 nibble = 0;
+					for (int i = 0; i < 4; i++)
+						if (Flevel[Fpins.d[i]]) nibble |= 1 << i;
+					strobes.push_back((Flevel[Fpins.rs] ? 0x10 : 0x00) | nibble);
+				}
+				bool read(int _pin){ return _pin == Fpins.d[3] ? busyFlag : false; }
+				void delayUs(unsigned int _us){ delayedUs += _us; }
+
+				void clear(){
+					strobes.clear();
+					pinWrites = 0;
+					delayedUs = 0;
+				}
+			private:
+				constexpr static int MAX_PINS = 64;
+				Tpins Fpins;
+				bool Flevel[MAX_PINS] = {};
+		};
+#endif
+
+		/**
+		 * @brief 4 bit parallel bus to the controller
+		 *
+		 * Transfers at most FbytesPerSlice bytes per call, so the caller can give the
+		 * scheduler back control between slices. With the RW pin wired (rw >= 0) the
+		 * busy flag is polled instead of waiting the worst case execution time.
+		 */
+		template <class Tgpio, int rs, int en, int d4, int d5, int d6, int d7, int rw = -1>
+		class Thd44780Gpio{
+			public:
+				Tgpio& gpio(){ return Fgpio; }
+				void setBytesPerSlice(int _n){ FbytesPerSlice = _n > 0 ? _n : 1; }
+
+				void begin(){
+					Fgpio.setOutput(rs);
+					Fgpio.setOutput(en);
+					if (rw >= 0){
+						Fgpio.setOutput(rw);
+						Fgpio.write(rw,false);
+					}
+					setDataDirection(true);
+					Fgpio.write(rs,false);
+					Fgpio.write(en,false);
+				}
+
+				/**
+				 * @brief transfer ops to the controller
+				 *
+				 * @param _waitMs set if the last op requires a wait before the next one
+				 * @return number of ops transferred, 0 if the controller is busy
+				 */
+				int transfer(const Thd44780Op* _ops, int _n, int& _waitMs){
+					int done = 0;
+					while (done < _n && done < FbytesPerSlice){
+						const auto& op = _ops[done];
+						if (rw >= 0 && !op.isNibble() && busy()) break;
+
+						Fgpio.write(rs,op.isData());
+						writeNibble(op.data >> 4);
+						if (!op.isNibble())
+							writeNibble(op.data & 0x0F);
+						done++;
+
+						//the busy flag is not available during initialization
+						if (rw < 0 || op.isNibble()){
+							if (op.waitMs()){
+								_waitMs = op.waitMs();
+								break;
+							}
+							Fgpio.delayUs(Thd44780Cmd::EXEC_TIME_US);
+						}
+					}
+					return done;
+				}
+
+			private:
+				Tgpio Fgpio;
+				int FbytesPerSlice = 4;
+
+				void setDataDirection(bool _output){
+					const int pins[] = {d4,d5,d6,d7};
+					for (auto pin : pins){
+						if (_output) Fgpio.setOutput(pin);
+						else Fgpio.setInput(pin);
+					}
+				}
+
+				void pulseEnable(){
+					Fgpio.write(en,true);
+					Fgpio.delayUs(1);
+					Fgpio.write(en,false);
+				}
+
+				void writeNibble(dtypes::uint8 _nibble){
+					Fgpio.write(d4,_nibble & 0x01);
+					Fgpio.write(d5,_nibble & 0x02);
+					Fgpio.write(d6,_nibble & 0x04);
+					Fgpio.write(d7,_nibble & 0x08);
+					pulseEnable();
+				}
+
+				bool busy(){
+					setDataDirection(false);
+					Fgpio.write(rs,false);
+					Fgpio.write(rw,true);
+					Fgpio.write(en,true);
+					Fgpio.delayUs(1);
+					bool bf = Fgpio.read(d7);
+					Fgpio.write(en,false);
+					//lower nibble (address counter) has to be clocked out as well
+					pulseEnable();
+					Fgpio.write(rw,false);
+					setDataDirection(true);
+					return bf;
+				}
+		};
+
+#if SDDS_ON_ARDUINO == 1
+		template <int rs, int en, int d4, int d5, int d6, int d7, int rw = -1>
+		using Thd44780Pins = Thd44780Gpio<TarduinoGpio,rs,en,d4,d5,d6,d7,rw>;
+#endif
+
+		/**
+		 * @brief native HD44780 backend that doesn't block the scheduler
+		 *
+		 * Every command is turned into a queue of ops that is streamed to the
+		 * controller by Ttransport in small slices driven by a Ttimer. Long running
+		 * commands (clear) wait on the timer instead of busy waiting. onTaskDone is
+		 * called when the whole transaction has been transferred.
+		 *
+		 * usage:
+		 *	typedef Thd44780<4,20,Thd44780Pins<1,2,3,4,5,6>,TgpioKeyPad<10,11,12,13,14,15>> Tlcd;
+		 *
+		 * @tparam Ttransport bus to the controller, see Thd44780Gpio
+		 * @tparam TkeyPad provides readKey and the key constants
+		 */
+		template <int nRows, int nColumns, class Ttransport, class TkeyPad = TnoKeyPad>
+		class Thd44780 : public TabstractTextDisplay<nRows,nColumns,typename TdispatchTo<Thd44780<nRows,nColumns,Ttransport,TkeyPad>>::type>, public TkeyPad{
+			template <int, int, class> friend class TabstractTextDisplay;
+			public:
+				Thd44780(){
+					//DDRAM address before the text
+					this->FcommandOverhead = 1;
+					this->FwriteMovesCursor = true;
+					this->FclearHomesCursor = true;
+					//CGRAM 0..7, 8..15 avoid the 0 terminator
+					this->FglyphBase = 8;
+					this->Fcharset = ThdA00Charset::table();
+					//ready when the initialization sequence has been transferred
+					this->Fready = false;
+					on(FioTimer){ static_cast<Thd44780*>(_self)->process(); };
+				}
+
+				Ttransport& transport(){ return Ftransport; }
+
+				void begin(){
+					Ftransport.begin();
+					this->setupKeys();
+
+					//initialization by instruction, see datasheet figure 24
+					addNibble(0x30,5);
+					addNibble(0x30,1);
+					addNibble(0x30,1);
+					addNibble(0x20,1);
+					addCmd(Thd44780Cmd::FUNCTION_SET | (nRows > 1 ? Thd44780Cmd::TWO_LINES : 0));
+					addCmd(Thd44780Cmd::DISPLAY_CONTROL | Thd44780Cmd::DISPLAY_ON | Thd44780Cmd::CURSOR_ON);
+					addCmd(Thd44780Cmd::CLEAR,Thd44780Cmd::CLEAR_TIME_MS);
+					addCmd(Thd44780Cmd::ENTRY_MODE | Thd44780Cmd::ENTRY_INCREMENT);
+
+					//>40ms after power on
+					Frunning = true;
+					FinitPending = true;
+					FioTimer.start(50);
+				}
+
+			protected:
+				void doSetCursor(const TcursorInterface _cursor) SDDS_TDS_OVERRIDE{
+					addCmd(Thd44780Cmd::ddramAddr(_cursor.x,_cursor.y,nColumns));
+					startTask();
+				}
+
+				void doClear() SDDS_TDS_OVERRIDE{
+					addCmd(Thd44780Cmd::CLEAR,Thd44780Cmd::CLEAR_TIME_MS);
+					startTask();
+				}
+
+				void doUpdateRow(TrowChanges _changes) SDDS_TDS_OVERRIDE{
+					if (_changes.setPosition)
+						addCmd(Thd44780Cmd::ddramAddr(_changes.firstChangedIdx,_changes.row,nColumns));
+					for (int i = 0; i < _changes.n; i++)
+						add(_changes._buffer[i],Thd44780Op::RS);
+					if (_changes.restoreCursor)
+						addCmd(Thd44780Cmd::ddramAddr(_changes.cursor.x,_changes.cursor.y,nColumns));
+					startTask();
+				}
+
+				void doDefineGlyph(int _slot, const Tglyph& _glyph) SDDS_TDS_OVERRIDE{
+					addCmd(Thd44780Cmd::SET_CGRAM | (_slot << 3));
+					for (auto i = 0; i < Tglyph::N_ROWS; i++)
+						add(_glyph.rows[i],Thd44780Op::RS);
+					startTask();
+				}
+
+			private:
+				//the core sends one command at a time, the queue holds the largest two of them anyway:
+				//address, row, cursor restore and a glyph (address + 8 rows)
+				constexpr static int ROW_OPS = 1 + nColumns + 1;
+				constexpr static int GLYPH_OPS = 1 + Tglyph::N_ROWS;
+				constexpr static int MAX_OPS = ROW_OPS + GLYPH_OPS;
+
+				Ttransport Ftransport;
+				Ttimer FioTimer;
+				Thd44780Op Fops[MAX_OPS];
+				int FopHead = 0;
+				int FopTail = 0;
+				bool Frunning = false;
+				bool FtaskPending = false;
+				bool FinitPending = false;
+				bool Foverflow = false;
+
+				/**
+				 * @brief an op that doesn't fit is a bug, without asserts the screen is resent afterwards
+				 */
+				void add(dtypes::uint8 _data, dtypes::uint8 _flags){
+					assert(FopTail < MAX_OPS);
+					if (FopTail >= MAX_OPS){
+						Foverflow = true;
+						return;
+					}
+					Fops[FopTail].data = _data;
+					Fops[FopTail].flags = _flags;
+					FopTail++;
+				}
+
+				void addCmd(dtypes::uint8 _cmd, int _waitMs = 0){ add(_cmd,_waitMs << Thd44780Op::WAIT_SHIFT); }
+				void addNibble(dtypes::uint8 _nibble, int _waitMs){ add(_nibble,Thd44780Op::NIBBLE | (_waitMs << Thd44780Op::WAIT_SHIFT)); }
+
+				void startTask(){
+					FtaskPending = true;
+					if (Frunning) return;
+					Frunning = true;
+					process();
+				}
+
+				void process(){
+					if (FopHead < FopTail){
+						int waitMs = 0;
+						FopHead += Ftransport.transfer(&Fops[FopHead],FopTail-FopHead,waitMs);
+						FioTimer.start(waitMs);
+						return;
+					}
+
+					FopHead = 0;
+					FopTail = 0;
+					Frunning = false;
+					if (Foverflow){
+						//the controller got a truncated command, the mirror can't be trusted
+						Foverflow = false;
+						this->invalidate();
+					}
+					if (FinitPending){
+						FinitPending = false;
+						this->setReady();
+					}
+					if (FtaskPending){
+						FtaskPending = false;
+						this->onTaskDone();
+					}
+				}
+		};
+
+	}
+}
+
+#endif //UHD44780_H
@@ -0,0 +1,158 @@
+#ifndef UHD44780PCF8574_H
+#define UHD44780PCF8574_H
+
+#include "uHD44780.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+#if SDDS_ON_ARDUINO != 1
+		/**
+		 * @brief records the I2C traffic instead of sending it
+		 *
+		 * Provides the part of the TwoWire interface used by Thd44780Pcf8574.
+		 */
+		class Ti2cRecorder{
+			public:
+				std::vector<dtypes::uint8> bytes;
+				dtypes::uint32 transactions = 0;
+				int maxTransactionSize = 0;
+				dtypes::uint8 address = 0;
+
+				void beginTransmission(dtypes::uint8 _address){
+					address = _address;
+					FcurrSize = 0;
+				}
+				int write(dtypes::uint8 _byte){
+					bytes.push_back(_byte);
+					FcurrSize++;
+					return 1;
+				}
+				int endTransmission(){
+					transactions++;
+					if (FcurrSize > maxTransactionSize) maxTransactionSize = FcurrSize;
+					return 0;
+				}
+
+				/**
+				 * @brief decode the recorded stream back to the strobes seen by the controller
+				 *
+				 * @return rs<<4 | nibble for every falling edge of EN, like TgpioRecorder
+				 */
+				std::vector<dtypes::uint8> strobes() const{
+					std::vector<dtypes::uint8> res;
+					dtypes::uint8 last = 0;
+					for (auto b : bytes){
+						if ((last & 0x04) && !(b & 0x04))
+							res.push_back(((last & 0x01) << 4) | (last >> 4));
+						last = b;
+					}
+					return res;
+				}
+
+				void clear(){
+					bytes.clear();
+					transactions = 0;
+					maxTransactionSize = 0;
+				}
+			private:
+				int FcurrSize = 0;
+		};
+#endif
+
+		/**
+		 * @brief HD44780 behind a PCF8574 I2C port expander (the common "backpack")
+		 *
+		 * Every nibble needs two bytes on the bus, one with EN high and one with EN
+		 * low. Instead of one transaction per strobe, as many ops as fit into the
+		 * buffer of the bus are packed into one transaction. One transaction is sent
+		 * per call of transfer, so Thd44780 yields to the scheduler in between.
+		 *
+		 * At 100kHz one byte on the bus takes ~90us, which is longer than the
+		 * execution time of a command. For faster busses use setPadding to add
+		 * idle bytes after every command.
+		 *
+		 * usage:
+		 *	typedef Thd44780<4,20,Thd44780Pcf8574<TwoWire,0x27>> Tlcd;
+		 *	Tlcd lcd;
+		 *	lcd.transport().setBus(&Wire);
+		 *
+		 * @tparam Tbus TwoWire or anything else with beginTransmission, write, endTransmission
+		 * @tparam BUS_BUFFER_SIZE bytes the bus accepts in one transaction
+		 */
+		template <class Tbus, dtypes::uint8 address, int BUS_BUFFER_SIZE = 32>
+		class Thd44780Pcf8574{
+			public:
+				//default wiring of the backpacks
+				constexpr static dtypes::uint8 PIN_RS 			= 0x01;
+				constexpr static dtypes::uint8 PIN_RW 			= 0x02;
+				constexpr static dtypes::uint8 PIN_EN 			= 0x04;
+				constexpr static dtypes::uint8 PIN_BACKLIGHT	= 0x08;
+
+				void setBus(Tbus* _bus){ Fbus = _bus; }
+				Tbus* bus(){ return Fbus; }
+
+				void setBacklight(bool _on){ Fbacklight = _on ? PIN_BACKLIGHT : 0; }
+
+				/**
+				 * @brief idle bytes after every command, 1 byte at 400kHz is ~22us
+				 */
+				void setPadding(int _bytes){ Fpadding = _bytes; }
+
+				void begin(){
+					if (!Fbus) return;
+					Fbus->beginTransmission(address);
+					Fbus->write(Fbacklight);
+					Fbus->endTransmission();
+				}
+
+				/**
+				 * @brief transfer as many ops as fit into one bus transaction
+				 *
+				 * @param _waitMs set if the last op requires a wait before the next one
+				 * @return number of ops transferred
+				 */
+				int transfer(const Thd44780Op* _ops, int _n, int& _waitMs){
+					if (!Fbus) return _n;
+
+					int done = 0;
+					int size = 0;
+					Fbus->beginTransmission(address);
+					while (done < _n){
+						const auto& op = _ops[done];
+						int opSize = (op.isNibble() ? 2 : 4) + Fpadding;
+						if (size + opSize > BUS_BUFFER_SIZE && size > 0) break;
+
+						dtypes::uint8 ctrl = Fbacklight | (op.isData() ? PIN_RS : 0);
+						writeNibble(ctrl,op.data & 0xF0);
+						if (!op.isNibble())
+							writeNibble(ctrl,op.data << 4);
+						for (int i = 0; i < Fpadding; i++)
+							Fbus->write(ctrl);
+						size += opSize;
+						done++;
+
+						if (op.waitMs()){
+							_waitMs = op.waitMs();
+							break;
+						}
+					}
+					Fbus->endTransmission();
+					return done;
+				}
+
+			private:
+				Tbus* Fbus = nullptr;
+				dtypes::uint8 Fbacklight = PIN_BACKLIGHT;
+				int Fpadding = 0;
+
+				void writeNibble(dtypes::uint8 _ctrl, dtypes::uint8 _highNibble){
+					Fbus->write(_highNibble | _ctrl | PIN_EN);
+					Fbus->write(_highNibble | _ctrl);
+				}
+		};
+
+	}
+}
+
+#endif //UHD44780PCF8574_H
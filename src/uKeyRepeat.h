@@ -0,0 +1,119 @@
+#ifndef UKEYREPEAT_H
+#define UKEYREPEAT_H
+
+#include "uTypedef.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief turns press/release of keys into key events with auto repeat
+		 *
+		 * Every press generates one event. While a key enabled for repeating is
+		 * held, it generates further events after FrepeatDelay, starting with
+		 * FrepeatInterval and getting faster by FrepeatAccel percent per event
+		 * down to FminRepeatInterval. Only the key pressed last repeats.
+		 *
+		 * Keys are identified by their index 0..nKeys-1, the mapping to key codes
+		 * is up to the keypad.
+		 *
+		 * @tparam QUEUE_SIZE presses that can be buffered until they are polled
+		 */
+		template <int nKeys, int QUEUE_SIZE = 8>
+		class TkeyRepeater{
+			public:
+				dtypes::uint16 FrepeatDelay = 400;
+				dtypes::uint16 FrepeatInterval = 150;
+				dtypes::uint16 FminRepeatInterval = 25;
+				dtypes::uint8 FrepeatAccel = 15;
+
+				void setRepeat(dtypes::uint16 _delay, dtypes::uint16 _interval, dtypes::uint16 _minInterval, dtypes::uint8 _accelPercent){
+					FrepeatDelay = _delay;
+					FrepeatInterval = _interval;
+					FminRepeatInterval = _minInterval;
+					FrepeatAccel = _accelPercent;
+				}
+
+				/**
+				 * @brief select the keys that repeat while held, bit n for key n
+				 */
+				void setRepeatMask(dtypes::uint32 _mask){ FrepeatMask = _mask; }
+
+				void press(int _key, dtypes::uint32 _now){
+					if (_key < 0 || _key >= nKeys || isDown(_key)) return;
+					FdownMask |= bit(_key);
+					FpressedAt[_key] = _now;
+					push(_key);
+					if (FrepeatMask & bit(_key)){
+						FrepeatKey = _key;
+						FcurrInterval = FrepeatInterval;
+						FnextRepeat = _now + FrepeatDelay;
+					}
+				}
+
+				void release(int _key, dtypes::uint32 _now){
+					if (_key < 0 || _key >= nKeys || !isDown(_key)) return;
+					FdownMask &= ~bit(_key);
+					FreleasedAt[_key] = _now;
+					if (FrepeatKey == _key) FrepeatKey = -1;
+				}
+
+				/**
+				 * @brief next key event
+				 *
+				 * @return index of the key or -1 if there is none
+				 */
+				int poll(dtypes::uint32 _now){
+					if (FqueueHead != FqueueTail){
+						int key = Fqueue[FqueueTail];
+						FqueueTail = (FqueueTail + 1) % QUEUE_SIZE;
+						return key;
+					}
+
+					if (FrepeatKey < 0 || dtypes::int32(_now - FnextRepeat) < 0) return -1;
+					FnextRepeat = _now + FcurrInterval;
+					auto next = FcurrInterval - FcurrInterval*FrepeatAccel/100;
+					FcurrInterval = next > FminRepeatInterval ? next : FminRepeatInterval;
+					return FrepeatKey;
+				}
+
+				bool isDown(int _key) const { return FdownMask & bit(_key); }
+				bool anyDown() const { return FdownMask != 0; }
+				dtypes::uint32 pressedAt(int _key) const { return FpressedAt[_key]; }
+				dtypes::uint32 releasedAt(int _key) const { return FreleasedAt[_key]; }
+
+				/**
+				 * @brief how long the key is held or has been held the last time
+				 */
+				dtypes::uint32 holdTime(int _key, dtypes::uint32 _now) const {
+					return (isDown(_key) ? _now : FreleasedAt[_key]) - FpressedAt[_key];
+				}
+
+			private:
+				dtypes::uint32 FdownMask = 0;
+				dtypes::uint32 FrepeatMask = 0;
+				dtypes::uint32 FpressedAt[nKeys] = {};
+				dtypes::uint32 FreleasedAt[nKeys] = {};
+
+				int FrepeatKey = -1;
+				dtypes::uint32 FnextRepeat = 0;
+				dtypes::uint16 FcurrInterval = 0;
+
+				dtypes::int8 Fqueue[QUEUE_SIZE];
+				int FqueueHead = 0;
+				int FqueueTail = 0;
+
+				static dtypes::uint32 bit(int _key){ return dtypes::uint32(1) << _key; }
+
+				void push(int _key){
+					auto next = (FqueueHead + 1) % QUEUE_SIZE;
+					if (next == FqueueTail) return;
+					Fqueue[FqueueHead] = _key;
+					FqueueHead = next;
+				}
+		};
+
+	}
+}
+
+#endif //UKEYREPEAT_H
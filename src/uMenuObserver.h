@@ -0,0 +1,406 @@
+#ifndef UMENUOBSERVER_H
+#define UMENUOBSERVER_H
+
+#include "uMultask.h"
+#include "uTypedef.h"
+#include "uSddsToString.h"
+#include "uTdsMillis.h"
+#include <new>			//required for AVR-GCC
+
+#ifndef SDDS_TDS_MAX_SUBSCRIPTIONS
+	//number of different menus that can be observed at the same time
+	#define SDDS_TDS_MAX_SUBSCRIPTIONS 4
+#endif
+
+#ifndef SDDS_TDS_FORMAT_CACHE_SIZE
+	//number of formatted values shared between sessions
+	#define SDDS_TDS_FORMAT_CACHE_SIZE 8
+#endif
+
+#ifndef SDDS_TDS_MAX_ITEM_OPTIONS
+	//number of items with display options like bar graphs
+	#define SDDS_TDS_MAX_ITEM_OPTIONS 8
+#endif
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief value of numeric items as float
+		 *
+		 * @return false if _d isn't numeric
+		 */
+		inline bool numericValue(Tdescr* _d, dtypes::float32& _value){
+			auto p = _d->pValue();
+			switch (_d->type()){
+				case sdds::Ttype::INT8: _value = *static_cast<dtypes::int8*>(p); return true;
+				case sdds::Ttype::INT16: _value = *static_cast<dtypes::int16*>(p); return true;
+				case sdds::Ttype::INT32: _value = *static_cast<dtypes::int32*>(p); return true;
+				case sdds::Ttype::UINT8: _value = *static_cast<dtypes::uint8*>(p); return true;
+				case sdds::Ttype::UINT16: _value = *static_cast<dtypes::uint16*>(p); return true;
+				case sdds::Ttype::UINT32: _value = *static_cast<dtypes::uint32*>(p); return true;
+				case sdds::Ttype::FLOAT32: _value = *static_cast<dtypes::float32*>(p); return true;
+				default: return false;
+			}
+		}
+
+		/**
+		 * @brief observes menus on behalf of all display sessions
+		 *
+		 * Every TtextDisplaySpike registers the window of the menu it shows. There
+		 * is one subscription per menu, no matter how many sessions show it, and
+		 * the observed range is the union of their windows. Formatted values are
+		 * cached until the menu reports a change, so items visible in several
+		 * sessions are only formatted once.
+		 *
+		 * Menus whose windows reach past MAX_OBSERVED_IDX or that find no free
+		 * subscription can't be observed by events, they are polled every
+		 * UPDATE_INTERVAL instead.
+		 *
+		 * It also holds the display options of items, which apply to all sessions.
+		 */
+		class TmenuObserver : public Tthread{
+			public:
+				constexpr static int MAX_OBSERVED_IDX = 255;		//highest index TobjectEvent can observe
+				constexpr static int MAX_VALUE_LEN = 24;
+				constexpr static int UPDATE_INTERVAL = 250;		//limit update rate to 4Hz
+
+				struct TitemOptions{
+					Tdescr* item = nullptr;
+					bool barGraph = false;
+					dtypes::float32 min = 0;
+					dtypes::float32 max = 0;
+
+					//deadband, see setDeadband
+					bool deadband = false;
+					dtypes::float32 absolute = 0;
+					dtypes::float32 relative = 0;
+					dtypes::uint32 holdMs = 0;
+					//value on the display
+					Tstruct* menu = nullptr;
+					bool shown = false;
+					bool changePending = false;		//value moved within the deadband
+					dtypes::float32 shownValue = 0;
+					dtypes::uint32 shownAt = 0;
+					char str[MAX_VALUE_LEN+1];
+				};
+
+				class Tlistener{
+					friend class TmenuObserver;
+					Tlistener* FnextListener = nullptr;
+					Tstruct* FobservedMenu = nullptr;
+					int FfirstObserved = 0;
+					int FlastObserved = 0;
+					public:
+						virtual void menuChanged() = 0;
+				};
+
+				TmenuObserver()
+					: FevPoll(this)
+				{
+					for (auto i = 0; i < SDDS_TDS_MAX_SUBSCRIPTIONS; i++)
+						new (&Fsubscriptions[i].event) TobjectEvent(this);
+				}
+
+				/**
+				 * @brief instance shared by all sessions that don't bring their own
+				 */
+				static TmenuObserver& shared(){
+					static TmenuObserver observer;
+					return observer;
+				}
+
+				/**
+				 * @brief observe the items _first.._last of _menu for _listener
+				 *
+				 * Replaces whatever the listener has observed before. A nullptr menu
+				 * stops observing.
+				 */
+				void observe(Tlistener* _listener, Tstruct* _menu, int _first, int _last){
+					if (!isRegistered(_listener)){
+						_listener->FnextListener = Flisteners;
+						Flisteners = _listener;
+					}
+					auto oldMenu = _listener->FobservedMenu;
+					_listener->FobservedMenu = _menu;
+					_listener->FfirstObserved = _first;
+					_listener->FlastObserved = _last;
+					if (oldMenu && oldMenu != _menu) updateSubscription(oldMenu);
+					if (_menu) updateSubscription(_menu);
+				}
+
+				/**
+				 * @brief formatted value of _d, shared between all sessions
+				 *
+				 * @return valid until the next call
+				 */
+				const char* format(Tdescr* _d, Tstruct* _menu){
+					for (auto i = 0; i < SDDS_TDS_FORMAT_CACHE_SIZE; i++)
+						if (Fcache[i].descr == _d) return Fcache[i].str;
+
+					auto o = options(_d);
+					if (o && o->deadband){
+						if (auto held = heldValue(*o,_d,_menu)) return held;
+					}
+
+					sdds::to_string(FworkStr,_d);
+					if (FworkStr.length() > MAX_VALUE_LEN) return FworkStr.c_str();
+
+					auto& entry = Fcache[FnextCacheEntry];
+					FnextCacheEntry = FnextCacheEntry+1 < SDDS_TDS_FORMAT_CACHE_SIZE ? FnextCacheEntry+1 : 0;
+					entry.descr = _d;
+					entry.menu = _menu;
+					strcpy(entry.str,FworkStr.c_str());
+					return entry.str;
+				}
+
+				/**
+				 * @brief show a numeric item as bar graph from _min to _max instead of text
+				 *
+				 * @return false if there are too many items with options
+				 */
+				bool setBarGraph(Tdescr& _item, dtypes::float32 _min, dtypes::float32 _max){
+					auto o = addOptions(&_item);
+					if (!o) return false;
+					o->barGraph = true;
+					o->min = _min;
+					o->max = _max;
+					return true;
+				}
+
+				/**
+				 * @brief show changes of a noisy numeric item only if they are meaningful
+				 *
+				 * The value on the display is replaced if the new one differs by more
+				 * than _absolute or _relative * |shown value|. Smaller changes are shown
+				 * once the value on the display is older than _holdMs, 0 never shows them.
+				 * Applies to all sessions, they all show the same value.
+				 *
+				 * @return false if there are too many items with options
+				 */
+				bool setDeadband(Tdescr& _item, dtypes::float32 _absolute, dtypes::float32 _relative = 0, dtypes::uint32 _holdMs = 0){
+					auto o = addOptions(&_item);
+					if (!o) return false;
+					o->deadband = true;
+					o->absolute = _absolute;
+					o->relative = _relative;
+					o->holdMs = _holdMs;
+					o->shown = false;
+					return true;
+				}
+
+				/**
+				 * @brief changes not shown because of a deadband
+				 */
+				dtypes::uint32 suppressedUpdates() const { return FsuppressedUpdates; }
+
+				/**
+				 * @return options of _d or nullptr if there are none
+				 */
+				TitemOptions* options(Tdescr* _d){
+					for (auto i = 0; i < FoptionCount; i++)
+						if (Foptions[i].item == _d) return &Foptions[i];
+					return nullptr;
+				}
+
+				void invalidate(Tstruct* _menu){
+					for (auto i = 0; i < SDDS_TDS_FORMAT_CACHE_SIZE; i++)
+						if (Fcache[i].menu == _menu) Fcache[i].descr = nullptr;
+				}
+
+			private:
+				union Tsubscription{
+					Tsubscription(){};
+					~Tsubscription(){};
+					TobjectEvent event;
+				};
+				Tsubscription Fsubscriptions[SDDS_TDS_MAX_SUBSCRIPTIONS];
+				Tstruct* FsubscribedMenus[SDDS_TDS_MAX_SUBSCRIPTIONS] = {};
+				bool FpolledSubscriptions[SDDS_TDS_MAX_SUBSCRIPTIONS] = {};		//window reaches past MAX_OBSERVED_IDX
+				Tevent FevPoll;
+				bool Fpolling = false;
+
+				struct TcacheEntry{
+					Tdescr* descr = nullptr;
+					Tstruct* menu = nullptr;
+					char str[MAX_VALUE_LEN+1];
+				};
+				TcacheEntry Fcache[SDDS_TDS_FORMAT_CACHE_SIZE];
+				int FnextCacheEntry = 0;
+				dtypes::string FworkStr;
+
+				Tlistener* Flisteners = nullptr;
+
+				TitemOptions Foptions[SDDS_TDS_MAX_ITEM_OPTIONS];
+				int FoptionCount = 0;
+				dtypes::uint32 FsuppressedUpdates = 0;
+
+				/**
+				 * @brief value of an item with deadband as it should be displayed
+				 *
+				 * @return nullptr if _d isn't numeric or too long, it is shown unfiltered then
+				 */
+				const char* heldValue(TitemOptions& _o, Tdescr* _d, Tstruct* _menu){
+					dtypes::float32 value;
+					if (!numericValue(_d,value)) return nullptr;
+					_o.menu = _menu;
+
+					auto now = tdsMillis();
+					if (_o.shown && value == _o.shownValue){
+						_o.changePending = false;
+						return _o.str;
+					}
+					if (_o.shown){
+						auto diff = value - _o.shownValue;
+						if (diff < 0) diff = -diff;
+						auto shownAbs = _o.shownValue < 0 ? -_o.shownValue : _o.shownValue;
+						auto band = _o.absolute > _o.relative * shownAbs ? _o.absolute : _o.relative * shownAbs;
+						auto expired = _o.holdMs > 0 && now - _o.shownAt >= _o.holdMs;
+						if (diff <= band && !expired){
+							if (!_o.changePending) FsuppressedUpdates++;
+							_o.changePending = true;
+							return _o.str;
+						}
+					}
+
+					sdds::to_string(FworkStr,_d);
+					if (FworkStr.length() > MAX_VALUE_LEN) return nullptr;
+					strcpy(_o.str,FworkStr.c_str());
+					_o.shown = true;
+					_o.changePending = false;
+					_o.shownValue = value;
+					_o.shownAt = now;
+					return _o.str;
+				}
+
+				/**
+				 * @brief a change held back by a deadband has to be shown now, nothing else may trigger it
+				 */
+				bool holdExpired(Tstruct* _menu){
+					auto now = tdsMillis();
+					for (auto i = 0; i < FoptionCount; i++){
+						auto& o = Foptions[i];
+						if (o.menu == _menu && o.changePending && o.holdMs > 0 && now - o.shownAt >= o.holdMs) return true;
+					}
+					return false;
+				}
+
+				TitemOptions* addOptions(Tdescr* _d){
+					if (auto o = options(_d)) return o;
+					if (FoptionCount >= SDDS_TDS_MAX_ITEM_OPTIONS) return nullptr;
+					Foptions[FoptionCount].item = _d;
+					return &Foptions[FoptionCount++];
+				}
+
+				bool isRegistered(Tlistener* _listener){
+					for (auto l = Flisteners; l; l = l->FnextListener)
+						if (l == _listener) return true;
+					return false;
+				}
+
+				int findSubscription(Tstruct* _menu){
+					for (auto i = 0; i < SDDS_TDS_MAX_SUBSCRIPTIONS; i++)
+						if (FsubscribedMenus[i] == _menu) return i;
+					return -1;
+				}
+
+				bool isPolled(Tstruct* _menu){
+					int idx = findSubscription(_menu);
+					return idx < 0 || FpolledSubscriptions[idx];
+				}
+
+				void startPolling(){
+					if (Fpolling) return;
+					Fpolling = true;
+					FevPoll.setTimeEvent(UPDATE_INTERVAL);
+				}
+
+				/**
+				 * @brief refresh the menus that can't be observed by events
+				 *
+				 * All caches are dropped before the first listener is notified, so
+				 * values shown in several sessions are still formatted once.
+				 */
+				void poll(){
+					bool any = false;
+					for (auto l = Flisteners; l; l = l->FnextListener){
+						if (!l->FobservedMenu || !isPolled(l->FobservedMenu)) continue;
+						invalidate(l->FobservedMenu);
+						any = true;
+					}
+					Fpolling = any;
+					if (!any) return;
+					for (auto l = Flisteners; l; l = l->FnextListener)
+						if (l->FobservedMenu && isPolled(l->FobservedMenu)) l->menuChanged();
+
+					//subscriptions may have been freed in the meantime, the values are up to date now
+					for (auto l = Flisteners; l; l = l->FnextListener){
+						if (!l->FobservedMenu || findSubscription(l->FobservedMenu) >= 0) continue;
+						if (findSubscription(nullptr) >= 0) updateSubscription(l->FobservedMenu);
+					}
+					FevPoll.setTimeEvent(UPDATE_INTERVAL);
+				}
+
+				/**
+				 * @brief (un)subscribe _menu and observe the union of all windows on it
+				 *
+				 * Cached values of items leaving the window wouldn't be invalidated anymore,
+				 * so the cache of the menu is dropped whenever the window changes.
+				 * TobjectEvent only covers items up to MAX_OBSERVED_IDX, windows reaching
+				 * further and menus without a free subscription are polled, see poll.
+				 */
+				void updateSubscription(Tstruct* _menu){
+					invalidate(_menu);
+
+					int first = MAX_OBSERVED_IDX;
+					int last = -1;
+					for (auto l = Flisteners; l; l = l->FnextListener){
+						if (l->FobservedMenu != _menu) continue;
+						if (l->FfirstObserved < first) first = l->FfirstObserved;
+						if (l->FlastObserved > last) last = l->FlastObserved;
+					}
+
+					int idx = findSubscription(_menu);
+					if (last < 0){
+						if (idx < 0) return;
+						_menu->value()->events()->remove(&Fsubscriptions[idx].event);
+						FsubscribedMenus[idx] = nullptr;
+						FpolledSubscriptions[idx] = false;
+						return;
+					}
+
+					if (idx < 0){
+						idx = findSubscription(nullptr);
+						if (idx < 0) return startPolling();
+						FsubscribedMenus[idx] = _menu;
+						_menu->value()->events()->push_first(&Fsubscriptions[idx].event);
+					}
+					FpolledSubscriptions[idx] = last > MAX_OBSERVED_IDX;
+					if (FpolledSubscriptions[idx]) startPolling();
+					if (first > MAX_OBSERVED_IDX) first = MAX_OBSERVED_IDX;
+					if (last > MAX_OBSERVED_IDX) last = MAX_OBSERVED_IDX;
+					Fsubscriptions[idx].event.setObservedRange(first,last);
+				}
+
+				void execute(Tevent* _ev) override{
+					if (_ev == &FevPoll) return poll();
+					for (auto i = 0; i < SDDS_TDS_MAX_SUBSCRIPTIONS; i++){
+						auto& ev = Fsubscriptions[i].event;
+						if (_ev != ev.event()) continue;
+
+						auto menu = FsubscribedMenus[i];
+						if (menu && (ev.getChangedItemCount() > 0 || holdExpired(menu))){
+							invalidate(menu);
+							for (auto l = Flisteners; l; l = l->FnextListener)
+								if (l->FobservedMenu == menu) l->menuChanged();
+						}
+						_ev->setTimeEvent(UPDATE_INTERVAL);
+						return;
+					}
+				}
+		};
+
+	}
+}
+
+#endif //UMENUOBSERVER_H
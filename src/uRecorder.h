@@ -0,0 +1,447 @@
+#ifndef URECORDER_H
+#define URECORDER_H
+
+#include "uAbstractTextDisplay.h"
+
+#if SDDS_ON_ARDUINO != 1
+	#include <cstdio>
+#endif
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief binary log of a display session
+		 *
+		 * header: 'T' 'D' 'S' 'R' VERSION rows columns glyphBase charset [table[256]]
+		 *	glyphBase is NO_GLYPHS if the display has none, the table of the character
+		 *	ROM follows if charset is 1, see uCharset.h
+		 * record: type dt payload
+		 *	dt is the time since the previous record in ms as unsigned LEB128
+		 *
+		 *	KEY		KEY_LEFT..KEY_ENTER, the keys are recorded by their role, not the code of the backend
+		 *	CLEAR
+		 *	CURSOR	x y
+		 *	ROW		row col n text[n]
+		 *	GLYPH	slot rows[8]
+		 */
+		struct Trecord{
+			constexpr static dtypes::uint8 VERSION	= 2;
+			constexpr static int HEADER_SIZE		= 9;
+			constexpr static dtypes::uint8 NO_GLYPHS	= 0xFF;
+
+			constexpr static dtypes::uint8 KEY		= 1;
+			constexpr static dtypes::uint8 CLEAR	= 2;
+			constexpr static dtypes::uint8 CURSOR	= 3;
+			constexpr static dtypes::uint8 ROW		= 4;
+			constexpr static dtypes::uint8 GLYPH	= 5;
+
+			constexpr static dtypes::uint8 KEY_LEFT		= 1;
+			constexpr static dtypes::uint8 KEY_RIGHT	= 2;
+			constexpr static dtypes::uint8 KEY_UP		= 3;
+			constexpr static dtypes::uint8 KEY_DOWN		= 4;
+			constexpr static dtypes::uint8 KEY_ESC		= 5;
+			constexpr static dtypes::uint8 KEY_ENTER	= 6;
+		};
+
+		/**
+		 * @brief writes the log to a stream, e.g. a second serial port
+		 */
+		template <class Tstream>
+		class TstreamSink{
+			public:
+				TstreamSink(Tstream* _stream) : Fstream(_stream) {}
+				void write(const dtypes::uint8* _data, int _len){ Fstream->write(_data,_len); }
+			private:
+				Tstream* Fstream;
+		};
+
+#if SDDS_ON_ARDUINO != 1
+		class TfileSink{
+			public:
+				TfileSink(FILE* _file) : Ffile(_file) {}
+				void write(const dtypes::uint8* _data, int _len){ fwrite(_data,1,_len,Ffile); }
+			private:
+				FILE* Ffile;
+		};
+
+		class TfileSource{
+			public:
+				TfileSource(FILE* _file) : Ffile(_file) {}
+				bool read(dtypes::uint8* _data, int _len){ return fread(_data,1,_len,Ffile) == size_t(_len); }
+			private:
+				FILE* Ffile;
+		};
+#endif
+
+		/**
+		 * @brief records the keys and all output of a display backend
+		 *
+		 * usage:
+		 *	typedef TcrystalFontzCFA635<4,20,Stream> Tcfa;
+		 *	TstreamSink<Stream> sink(&Serial);
+		 *	Trecorder<Tcfa,TstreamSink<Stream>> disp(&sink,&Serial2);
+		 *	TtextDisplaySpike<decltype(disp)> tds(userStruct,disp);
+		 *
+		 * @tparam Tdisplay any backend, the remaining constructor arguments are passed to it
+		 * @tparam Tsink write(data,len)
+		 */
+		template <class Tdisplay, class Tsink>
+		class Trecorder : public Tdisplay{
+			//the core calls the backend directly with static dispatch and would bypass the recorder
+			static_assert(SDDS_TDS_STATIC_DISPATCH == 0 && sizeof(Tdisplay) > 0, "Trecorder needs SDDS_TDS_STATIC_DISPATCH 0");
+			public:
+				template <class... Targs>
+				Trecorder(Tsink* _sink, Targs... _args)
+					: Tdisplay(_args...)
+					, Fsink(_sink)
+				{
+					//the backend has chosen its glyph base and charset in its constructor
+					dtypes::uint8 header[Trecord::HEADER_SIZE] = {'T','D','S','R',Trecord::VERSION,Tdisplay::N_LINES,Tdisplay::N_COLUMNS,
+						dtypes::uint8(this->FglyphBase < 0 ? Trecord::NO_GLYPHS : this->FglyphBase),
+						dtypes::uint8(this->Fcharset ? 1 : 0)};
+					Fsink->write(header,sizeof(header));
+					if (this->Fcharset){
+						dtypes::uint8 chunk[16];
+						for (auto i = 0; i < 256; i += sizeof(chunk)){
+							for (auto j = 0; j < int(sizeof(chunk)); j++)
+								chunk[j] = translate(this->Fcharset,static_cast<char>(i+j));
+							Fsink->write(chunk,sizeof(chunk));
+						}
+					}
+					FlastRecord = tdsMillis();
+				}
+
+				int readKey(){
+					auto key = Tdisplay::readKey();
+					dtypes::uint8 role = keyRole(key);
+					if (role != 0) record(Trecord::KEY,&role,1);
+					return key;
+				}
+
+			protected:
+				void doClear() SDDS_TDS_OVERRIDE{
+					record(Trecord::CLEAR,nullptr,0);
+					Tdisplay::doClear();
+				}
+
+				void doSetCursor(const TcursorInterface _cursor) SDDS_TDS_OVERRIDE{
+					dtypes::uint8 pos[] = {dtypes::uint8(_cursor.x), dtypes::uint8(_cursor.y)};
+					record(Trecord::CURSOR,pos,sizeof(pos));
+					Tdisplay::doSetCursor(_cursor);
+				}
+
+				void doUpdateRow(const TrowChanges _changes) SDDS_TDS_OVERRIDE{
+					dtypes::uint8 payload[3+Tdisplay::N_COLUMNS];
+					payload[0] = _changes.row;
+					payload[1] = _changes.firstChangedIdx;
+					payload[2] = _changes.n;
+					memcpy(&payload[3],_changes._buffer,_changes.n);
+					record(Trecord::ROW,payload,3+_changes.n);
+					Tdisplay::doUpdateRow(_changes);
+				}
+
+				void doDefineGlyph(int _slot, const Tglyph& _glyph) SDDS_TDS_OVERRIDE{
+					dtypes::uint8 payload[1+Tglyph::N_ROWS];
+					payload[0] = _slot;
+					memcpy(&payload[1],_glyph.rows,Tglyph::N_ROWS);
+					record(Trecord::GLYPH,payload,sizeof(payload));
+					Tdisplay::doDefineGlyph(_slot,_glyph);
+				}
+
+			private:
+				Tsink* Fsink;
+				dtypes::uint32 FlastRecord;
+
+				/**
+				 * @return Trecord::KEY_LEFT..KEY_ENTER, 0 for keys the menu doesn't handle
+				 */
+				static dtypes::uint8 keyRole(int _key){
+					switch (_key){
+						case Tdisplay::SDDS_TDS_KEY_LEFT: return Trecord::KEY_LEFT;
+						case Tdisplay::SDDS_TDS_KEY_RIGHT: return Trecord::KEY_RIGHT;
+						case Tdisplay::SDDS_TDS_KEY_UP: return Trecord::KEY_UP;
+						case Tdisplay::SDDS_TDS_KEY_DOWN: return Trecord::KEY_DOWN;
+						case Tdisplay::SDDS_TDS_KEY_ESC: return Trecord::KEY_ESC;
+						case Tdisplay::SDDS_TDS_KEY_ENTER: return Trecord::KEY_ENTER;
+						default: return 0;
+					}
+				}
+
+				void record(dtypes::uint8 _type, const dtypes::uint8* _payload, int _len){
+					auto now = tdsMillis();
+					dtypes::uint32 dt = now - FlastRecord;
+					FlastRecord = now;
+
+					dtypes::uint8 head[6];
+					int n = 0;
+					head[n++] = _type;
+					do{
+						head[n++] = (dt & 0x7F) | (dt > 0x7F ? 0x80 : 0);
+						dt >>= 7;
+					} while (dt);
+					Fsink->write(head,n);
+					if (_len > 0) Fsink->write(_payload,_len);
+				}
+		};
+
+#if SDDS_ON_ARDUINO != 1
+		/**
+		 * @brief replays a recording into TtextDisplaySpike and compares the output
+		 *
+		 * Keys are handed out as fast as the display settles: before every key,
+		 * the screen produced so far is compared with the screen of the recording
+		 * at the same point. The screens are compared instead of the single calls,
+		 * as the same screen can legitimately be reached with different calls.
+		 * The glyph base and the charset of the recorded backend are taken from
+		 * the recording, so the translated text compares equal.
+		 *
+		 * usage:
+		 *	TfileSource source(fopen("session.tdsr","rb"));
+		 *	TreplayDisplay<4,20,TfileSource> disp(&source);
+		 *	TtextDisplaySpike<decltype(disp)> tds(userStruct,disp);
+		 *	while (!disp.done()) TtaskHandler::handleEvents();
+		 *	disp.report(stdout);
+		 */
+		template <int nRows, int nColumns, class Tsource>
+		class TreplayDisplay : public TabstractTextDisplay<nRows,nColumns,typename TdispatchTo<TreplayDisplay<nRows,nColumns,Tsource>>::type>{
+			template <int, int, class> friend class TabstractTextDisplay;
+			public:
+				//same codes as the console display, the recording holds the roles of the keys
+				constexpr static int SDDS_TDS_KEY_LEFT = 75;
+				constexpr static int SDDS_TDS_KEY_RIGHT = 77;
+				constexpr static int SDDS_TDS_KEY_UP = 72;
+				constexpr static int SDDS_TDS_KEY_DOWN = 80;
+				constexpr static int SDDS_TDS_KEY_ESC = 27;
+				constexpr static int SDDS_TDS_KEY_ENTER = 13;
+
+				struct Tstatistic{
+					dtypes::uint32 keys = 0;
+					dtypes::uint32 mismatches = 0;
+					dtypes::uint32 firstMismatchKey = 0;
+					dtypes::uint32 recordedCalls = 0;
+					dtypes::uint32 recordedBytes = 0;		//text of ROW records
+					dtypes::uint32 calls = 0;
+					dtypes::uint32 bytes = 0;
+					dtypes::uint32 elapsedMs = 0;
+				};
+
+				TreplayDisplay(Tsource* _source){
+					Fsource = _source;
+					clearScreen(Fexpected);
+					clearScreen(Factual);
+
+					dtypes::uint8 header[Trecord::HEADER_SIZE];
+					Fdone = !Fsource->read(header,sizeof(header)) || memcmp(header,"TDSR",4) != 0
+						|| header[4] != Trecord::VERSION || header[5] != nRows || header[6] != nColumns;
+					if (!Fdone){
+						this->FglyphBase = header[7] == Trecord::NO_GLYPHS ? -1 : header[7];
+						if (header[8]){
+							Fdone = !Fsource->read(FcharsetTable,sizeof(FcharsetTable));
+							this->Fcharset = FcharsetTable;
+						}
+						else this->Fcharset = nullptr;
+					}
+					Fbegin = tdsMillis();
+				}
+
+				/**
+				 * @brief time to wait after the display has settled before the next key,
+				 * for applications that update the screen asynchronously
+				 */
+				void setSettleTime(dtypes::uint32 _ms){ FsettleTime = _ms; }
+
+				bool done() const { return Fdone; }
+				const Tstatistic& statistic() const { return Fstat; }
+
+				void report(FILE* _out){
+					auto s = Fstat.elapsedMs > 0 ? Fstat.elapsedMs : 1;
+					fprintf(_out,"keys %u in %u ms, %.1f keys/s\n",Fstat.keys,Fstat.elapsedMs,Fstat.keys*1000.0/s);
+					fprintf(_out,"calls %u (recorded %u), text bytes %u (recorded %u)\n",Fstat.calls,Fstat.recordedCalls,Fstat.bytes,Fstat.recordedBytes);
+					if (Fstat.mismatches == 0) fprintf(_out,"output matches the recording\n");
+					else fprintf(_out,"%u mismatches, first before key %u\n",Fstat.mismatches,Fstat.firstMismatchKey);
+				}
+
+				int readKey(){
+					//keys handled in one frame when recorded go in one frame again
+					if (FchainedKey > 0){
+						auto key = FchainedKey;
+						FchainedKey = 0;
+						Fstat.keys++;
+						return key;
+					}
+					if (Fdone || Fstat.calls == 0 || this->updatePending()) return 0;
+					auto now = tdsMillis();
+					if (!Fsettled){
+						Fsettled = true;
+						FsettledAt = now;
+					}
+					if (now - FsettledAt < FsettleTime) return 0;
+					Fsettled = false;
+
+					int key = nextKey();
+					compare();
+					if (key < 0){
+						Fdone = true;
+						Fstat.elapsedMs = now - Fbegin;
+						return 0;
+					}
+					Fstat.keys++;
+					FchainedKey = nextChainedKey();
+					return key;
+				}
+
+			protected:
+				void doClear() SDDS_TDS_OVERRIDE{
+					Fstat.calls++;
+					clearScreen(Factual);
+					Factual.cursor.x = 0;
+					Factual.cursor.y = 0;
+					this->onTaskDone();
+				}
+
+				void doSetCursor(const TcursorInterface _cursor) SDDS_TDS_OVERRIDE{
+					Fstat.calls++;
+					Factual.cursor = _cursor;
+					this->onTaskDone();
+				}
+
+				void doUpdateRow(const TrowChanges _changes) SDDS_TDS_OVERRIDE{
+					Fstat.calls++;
+					Fstat.bytes += _changes.n;
+					memcpy(&Factual.text[_changes.row][_changes.firstChangedIdx],_changes._buffer,_changes.n);
+					this->onTaskDone();
+				}
+
+				void doDefineGlyph(int _slot, const Tglyph& _glyph) SDDS_TDS_OVERRIDE{
+					Fstat.calls++;
+					Factual.glyphs[_slot] = _glyph;
+					this->onTaskDone();
+				}
+
+			private:
+				struct Tscreen{
+					char text[nRows][nColumns];
+					Tglyph glyphs[8];
+					TcursorInterface cursor;
+				};
+
+				Tsource* Fsource;
+				dtypes::uint8 FcharsetTable[256];
+				Tscreen Fexpected;
+				Tscreen Factual;
+				Tstatistic Fstat;
+				bool Fdone = false;
+				int FchainedKey = 0;
+				int FpeekedType = -1;
+				bool Fsettled = false;
+				dtypes::uint32 FsettleTime = 0;
+				dtypes::uint32 FsettledAt = 0;
+				dtypes::uint32 Fbegin = 0;
+
+				static void clearScreen(Tscreen& _screen){
+					memset(_screen.text,' ',sizeof(_screen.text));
+				}
+
+				/**
+				 * @brief apply the recorded output up to the next key
+				 *
+				 * @return key or -1 at the end of the recording
+				 */
+				int nextKey(){
+					dtypes::uint8 buf[3+nColumns];
+					int type;
+					while ((type = readType()) >= 0){
+						if (type == Trecord::KEY)
+							return Fsource->read(buf,1) ? keyCode(buf[0]) : -1;
+
+						Fstat.recordedCalls++;
+						switch (type){
+							case Trecord::CLEAR:
+								clearScreen(Fexpected);
+								Fexpected.cursor.x = 0;
+								Fexpected.cursor.y = 0;
+								break;
+							case Trecord::CURSOR:
+								if (!Fsource->read(buf,2)) return -1;
+								Fexpected.cursor.x = buf[0];
+								Fexpected.cursor.y = buf[1];
+								break;
+							case Trecord::ROW:
+								if (!Fsource->read(buf,3) || buf[0] >= nRows || buf[1] + buf[2] > nColumns) return -1;
+								if (!Fsource->read(reinterpret_cast<dtypes::uint8*>(&Fexpected.text[buf[0]][buf[1]]),buf[2])) return -1;
+								Fstat.recordedBytes += buf[2];
+								break;
+							case Trecord::GLYPH:
+								if (!Fsource->read(buf,1+Tglyph::N_ROWS) || buf[0] >= 8) return -1;
+								memcpy(Fexpected.glyphs[buf[0]].rows,&buf[1],Tglyph::N_ROWS);
+								break;
+							default:
+								return -1;
+						}
+					}
+					return -1;
+				}
+
+				/**
+				 * @brief type of the next record, skips the time
+				 *
+				 * @return -1 at the end
+				 */
+				int readType(){
+					if (FpeekedType >= 0){
+						auto type = FpeekedType;
+						FpeekedType = -1;
+						return type;
+					}
+					dtypes::uint8 type;
+					dtypes::uint8 b;
+					if (!Fsource->read(&type,1)) return -1;
+					do{
+						if (!Fsource->read(&b,1)) return -1;
+					} while (b & 0x80);
+					return type;
+				}
+
+				/**
+				 * @return key recorded directly after the last one without any output in between, 0 if none
+				 */
+				int nextChainedKey(){
+					FpeekedType = readType();
+					if (FpeekedType != Trecord::KEY) return 0;
+					FpeekedType = -1;
+					dtypes::uint8 key;
+					return Fsource->read(&key,1) ? keyCode(key) : 0;
+				}
+
+				/**
+				 * @brief code of a recorded key role, 0 if unknown
+				 */
+				static int keyCode(dtypes::uint8 _role){
+					switch (_role){
+						case Trecord::KEY_LEFT: return SDDS_TDS_KEY_LEFT;
+						case Trecord::KEY_RIGHT: return SDDS_TDS_KEY_RIGHT;
+						case Trecord::KEY_UP: return SDDS_TDS_KEY_UP;
+						case Trecord::KEY_DOWN: return SDDS_TDS_KEY_DOWN;
+						case Trecord::KEY_ESC: return SDDS_TDS_KEY_ESC;
+						case Trecord::KEY_ENTER: return SDDS_TDS_KEY_ENTER;
+						default: return 0;
+					}
+				}
+
+				void compare(){
+					bool equal = memcmp(Fexpected.text,Factual.text,sizeof(Fexpected.text)) == 0
+						&& Fexpected.cursor.x == Factual.cursor.x && Fexpected.cursor.y == Factual.cursor.y;
+					if (equal) return;
+					if (Fstat.mismatches++ == 0) Fstat.firstMismatchKey = Fstat.keys;
+					//continue from the recorded state, so one difference isn't reported for every key
+					memcpy(Factual.text,Fexpected.text,sizeof(Factual.text));
+					Factual.cursor = Fexpected.cursor;
+				}
+		};
+#endif
+
+	}
+}
+
+#endif //URECORDER_H
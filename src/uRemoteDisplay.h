@@ -0,0 +1,157 @@
+#ifndef UREMOTEDISPLAY_H
+#define UREMOTEDISPLAY_H
+
+#include "uAbstractTextDisplay.h"
+#include "uRemoteProtocol.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief display on the other end of a byte pipe, see uRemoteProtocol.h
+		 *
+		 * Changes are sent as run length encoded row spans, keys come back over
+		 * the same stream. A viewer connecting late sends HELLO and gets one full
+		 * frame, then only deltas. As long as no viewer has said HELLO nothing is sent.
+		 *
+		 * usage:
+		 *	typedef TremoteDisplay<4,20,Stream> Tremote;
+		 *	Tremote remote(&Serial);
+		 *	TtextDisplaySpike<Tremote> tds(userStruct,remote);
+		 *
+		 * @tparam Tstream write(buf,n) returning the bytes taken, available(), read()
+		 */
+		template <int nRows, int nColumns, class Tstream>
+		class TremoteDisplay : public TabstractTextDisplay<nRows,nColumns,typename TdispatchTo<TremoteDisplay<nRows,nColumns,Tstream>>::type>{
+			template <int, int, class> friend class TabstractTextDisplay;
+			public:
+				//same codes as the console display
+				constexpr static int SDDS_TDS_KEY_LEFT = 75;
+				constexpr static int SDDS_TDS_KEY_RIGHT = 77;
+				constexpr static int SDDS_TDS_KEY_UP = 72;
+				constexpr static int SDDS_TDS_KEY_DOWN = 80;
+				constexpr static int SDDS_TDS_KEY_ESC = 27;
+				constexpr static int SDDS_TDS_KEY_ENTER = 13;
+
+				TremoteDisplay(Tstream* _stream){
+					Fstream = _stream;
+					this->FcommandOverhead = TremoteMsg::OVERHEAD + 2;
+					this->FglyphBase = TremoteMsg::GLYPH_BASE;
+					FreadTimer.start(10);
+					on(FreadTimer){ static_cast<TremoteDisplay*>(_self)->receive(); };
+					on(FwriteTimer){ static_cast<TremoteDisplay*>(_self)->transmit(); };
+				}
+
+				bool connected(){ return Fconnected; }
+
+				int readKey(){
+					if (FkeyHead == FkeyTail) return 0;
+					auto key = Fkeys[FkeyTail];
+					FkeyTail = (FkeyTail + 1) % KEY_QUEUE_SIZE;
+					return key;
+				}
+
+			protected:
+				void doClear() SDDS_TDS_OVERRIDE{
+					if (FresetPending){
+						FresetPending = false;
+						dtypes::uint8 dims[] = {nRows, nColumns};
+						addFrame(TremoteMsg::RESET,dims,sizeof(dims));
+					}
+					addFrame(TremoteMsg::CLEAR,nullptr,0);
+					startTx();
+				}
+
+				void doSetCursor(const TcursorInterface _cursor) SDDS_TDS_OVERRIDE{
+					dtypes::uint8 pos[] = {dtypes::uint8(_cursor.x), dtypes::uint8(_cursor.y)};
+					addFrame(TremoteMsg::CURSOR,pos,sizeof(pos));
+					startTx();
+				}
+
+				void doUpdateRow(const TrowChanges _changes) SDDS_TDS_OVERRIDE{
+					dtypes::uint8 payload[TremoteMsg::rowPayloadSize(nColumns)];
+					payload[0] = _changes.row;
+					payload[1] = _changes.firstChangedIdx;
+					auto n = remoteRleEncode(reinterpret_cast<const dtypes::uint8*>(_changes._buffer),_changes.n,&payload[2]);
+					addFrame(TremoteMsg::ROW,payload,n+2);
+					startTx();
+				}
+
+				void doDefineGlyph(int _slot, const Tglyph& _glyph) SDDS_TDS_OVERRIDE{
+					dtypes::uint8 payload[1+Tglyph::N_ROWS];
+					payload[0] = _slot;
+					memcpy(&payload[1],_glyph.rows,Tglyph::N_ROWS);
+					addFrame(TremoteMsg::GLYPH,payload,sizeof(payload));
+					startTx();
+				}
+
+			private:
+				constexpr static int KEY_QUEUE_SIZE = 8;
+				constexpr static int TX_BUFFER_SIZE = 2*TremoteMsg::OVERHEAD + 2 + TremoteMsg::rowPayloadSize(nColumns);
+
+				Tstream* Fstream;
+				Ttimer FreadTimer;
+				Ttimer FwriteTimer;
+				TremoteParser<8> Fparser;
+
+				dtypes::uint8 FtxBuffer[TX_BUFFER_SIZE];
+				int FtxHead = 0;
+				int FtxTail = 0;
+				dtypes::uint8 FtxSeq = 0;
+
+				bool Fconnected = false;
+				bool FresetPending = false;
+
+				dtypes::uint8 Fkeys[KEY_QUEUE_SIZE];
+				int FkeyHead = 0;
+				int FkeyTail = 0;
+
+				void addFrame(dtypes::uint8 _type, const dtypes::uint8* _payload, int _len){
+					FtxHead += remoteFrame(&FtxBuffer[FtxHead],_type,FtxSeq++,_payload,_len);
+				}
+
+				/**
+				 * @brief frames are dropped without a viewer, the display keeps running
+				 */
+				void startTx(){
+					if (!Fconnected) FtxHead = 0;
+					FtxTail = 0;
+					transmit();
+				}
+
+				void transmit(){
+					if (FtxTail < FtxHead){
+						FtxTail += Fstream->write(&FtxBuffer[FtxTail],FtxHead-FtxTail);
+						if (FtxTail < FtxHead){
+							FwriteTimer.start(1);
+							return;
+						}
+					}
+					FtxHead = 0;
+					FtxTail = 0;
+					this->onTaskDone();
+				}
+
+				void receive(){
+					while (Fstream->available()){
+						if (!Fparser.push(Fstream->read())) continue;
+						if (Fparser.type() == TremoteMsg::HELLO){
+							Fconnected = true;
+							FresetPending = true;
+							this->invalidate();
+						}
+						else if (Fparser.type() == TremoteMsg::KEY && Fparser.len() == 1){
+							auto next = (FkeyHead + 1) % KEY_QUEUE_SIZE;
+							if (next == FkeyTail) continue;
+							Fkeys[FkeyHead] = Fparser.payload()[0];
+							FkeyHead = next;
+						}
+					}
+					FreadTimer.start(10);
+				}
+		};
+
+	}
+}
+
+#endif //UREMOTEDISPLAY_H
@@ -0,0 +1,175 @@
+#ifndef UREMOTEPROTOCOL_H
+#define UREMOTEPROTOCOL_H
+
+#include "uTypedef.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief protocol between TremoteDisplay and a viewer
+		 *
+		 * frame: SYNC type seq len payload[len] crc
+		 *	seq counts the frames of each direction, a gap tells the viewer to send HELLO
+		 *	crc is a CRC-8 (polynomial 0x07) over type, seq, len and the payload
+		 *
+		 * display -> viewer
+		 *	RESET	rows cols			answer to HELLO, followed by a full frame
+		 *	CLEAR
+		 *	CURSOR	x y
+		 *	ROW		row col rle...		text from col on, see remoteRleEncode
+		 *	GLYPH	slot rows[8]		user defined character, code = GLYPH_BASE + slot
+		 *
+		 * viewer -> display
+		 *	HELLO						(re)connect, the display sends everything again
+		 *	KEY		code				SDDS_TDS_KEY_* of TremoteDisplay
+		 *
+		 * Text is Latin-1.
+		 */
+		struct TremoteMsg{
+			constexpr static dtypes::uint8 SYNC			= 0xA5;
+
+			constexpr static dtypes::uint8 RESET		= 0x01;
+			constexpr static dtypes::uint8 CLEAR		= 0x02;
+			constexpr static dtypes::uint8 CURSOR		= 0x03;
+			constexpr static dtypes::uint8 ROW			= 0x04;
+			constexpr static dtypes::uint8 GLYPH		= 0x05;
+
+			constexpr static dtypes::uint8 HELLO		= 0x10;
+			constexpr static dtypes::uint8 KEY			= 0x11;
+
+			constexpr static int HEADER_SIZE = 4;
+			constexpr static int OVERHEAD = HEADER_SIZE + 1;
+			constexpr static int GLYPH_BASE = 8;
+
+			//payload of a ROW message for n characters in the worst case
+			constexpr static int rowPayloadSize(int _n){ return 2 + _n + (_n + 127)/128; }
+		};
+
+		inline dtypes::uint8 remoteCrc8(const dtypes::uint8* _data, int _len, dtypes::uint8 _crc = 0){
+			while (_len-- > 0){
+				_crc ^= *_data++;
+				for (auto i = 0; i < 8; i++)
+					_crc = (_crc & 0x80) ? (_crc << 1) ^ 0x07 : (_crc << 1);
+			}
+			return _crc;
+		}
+
+		/**
+		 * @brief run length encoding of row spans
+		 *
+		 * control byte c < 0x80: c+1 literal bytes follow
+		 * control byte c >= 0x80: the next byte is repeated c-0x80+3 times
+		 *
+		 * @return size of the encoded data, at most _n + (_n+127)/128
+		 */
+		inline int remoteRleEncode(const dtypes::uint8* _src, int _n, dtypes::uint8* _dst){
+			int out = 0;
+			int i = 0;
+			while (i < _n){
+				int run = 1;
+				while (i + run < _n && run < 130 && _src[i+run] == _src[i]) run++;
+				if (run >= 3){
+					_dst[out++] = 0x80 + run - 3;
+					_dst[out++] = _src[i];
+					i += run;
+					continue;
+				}
+
+				//literals until the next run of 3
+				int lit = 0;
+				while (i + lit < _n && lit < 128){
+					if (i + lit + 2 < _n && _src[i+lit] == _src[i+lit+1] && _src[i+lit] == _src[i+lit+2]) break;
+					lit++;
+				}
+				_dst[out++] = lit - 1;
+				for (auto j = 0; j < lit; j++)
+					_dst[out++] = _src[i++];
+			}
+			return out;
+		}
+
+		/**
+		 * @return number of decoded bytes, -1 if the data is invalid or doesn't fit into _max
+		 */
+		inline int remoteRleDecode(const dtypes::uint8* _src, int _n, dtypes::uint8* _dst, int _max){
+			int out = 0;
+			int i = 0;
+			while (i < _n){
+				int c = _src[i++];
+				if (c >= 0x80){
+					int run = c - 0x80 + 3;
+					if (i >= _n || out + run > _max) return -1;
+					while (run-- > 0) _dst[out++] = _src[i];
+					i++;
+					continue;
+				}
+				int lit = c + 1;
+				if (i + lit > _n || out + lit > _max) return -1;
+				while (lit-- > 0) _dst[out++] = _src[i++];
+			}
+			return out;
+		}
+
+		/**
+		 * @brief builds frames, the buffer has to hold OVERHEAD + payload
+		 *
+		 * @return size of the frame
+		 */
+		inline int remoteFrame(dtypes::uint8* _buf, dtypes::uint8 _type, dtypes::uint8 _seq, const dtypes::uint8* _payload, int _len){
+			_buf[0] = TremoteMsg::SYNC;
+			_buf[1] = _type;
+			_buf[2] = _seq;
+			_buf[3] = _len;
+			for (auto i = 0; i < _len; i++)
+				_buf[TremoteMsg::HEADER_SIZE+i] = _payload[i];
+			_buf[TremoteMsg::HEADER_SIZE+_len] = remoteCrc8(&_buf[1],TremoteMsg::HEADER_SIZE-1+_len);
+			return TremoteMsg::OVERHEAD + _len;
+		}
+
+		/**
+		 * @brief byte wise parser for frames, resyncs on the next SYNC after errors
+		 */
+		template <int MAX_PAYLOAD = 255>
+		class TremoteParser{
+			public:
+				/**
+				 * @return true if a valid frame is complete, see type/seq/payload/len
+				 */
+				bool push(dtypes::uint8 _byte){
+					if (Fpos == 0){
+						if (_byte == TremoteMsg::SYNC) Fbuf[Fpos++] = _byte;
+						return false;
+					}
+					Fbuf[Fpos++] = _byte;
+					if (Fpos == TremoteMsg::HEADER_SIZE && Fbuf[3] > MAX_PAYLOAD){
+						Ferrors++;
+						Fpos = 0;
+						return false;
+					}
+					if (Fpos < TremoteMsg::OVERHEAD || Fpos < TremoteMsg::OVERHEAD + Fbuf[3]) return false;
+
+					Fpos = 0;
+					if (remoteCrc8(&Fbuf[1],TremoteMsg::HEADER_SIZE-1+Fbuf[3]) != Fbuf[TremoteMsg::HEADER_SIZE+Fbuf[3]]){
+						Ferrors++;
+						return false;
+					}
+					return true;
+				}
+
+				dtypes::uint8 type() const { return Fbuf[1]; }
+				dtypes::uint8 seq() const { return Fbuf[2]; }
+				int len() const { return Fbuf[3]; }
+				const dtypes::uint8* payload() const { return &Fbuf[TremoteMsg::HEADER_SIZE]; }
+				dtypes::uint32 errors() const { return Ferrors; }
+
+			private:
+				dtypes::uint8 Fbuf[TremoteMsg::OVERHEAD + MAX_PAYLOAD];
+				int Fpos = 0;
+				dtypes::uint32 Ferrors = 0;
+		};
+
+	}
+}
+
+#endif //UREMOTEPROTOCOL_H
@@ -0,0 +1,125 @@
+#ifndef UTABLELAYOUT_H
+#define UTABLELAYOUT_H
+
+#include "uTdsConfig.h"
+#include "uCharset.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		struct Talign{
+			constexpr static int LEFT	= 0;
+			constexpr static int RIGHT	= 1;	//texts that don't fit lose their beginning
+			constexpr static int CENTER	= 2;
+		};
+
+		/**
+		 * @brief the _width Latin-1 characters of a cell showing the UTF-8 _str, padded with blanks or truncated
+		 */
+		SDDS_TDS_SHARED void tdsLayoutCell(char* _cell, int _width, int _align, const char* _str){
+			int len = Tutf8::length(_str);
+			if (len > _width){
+				if (_align == Talign::RIGHT)
+					for (auto i = len - _width; i > 0; i--) Tutf8::next(_str);
+				len = _width;
+			}
+			int fill = _width - len;
+			int x = 0;
+			if (_align == Talign::RIGHT)
+				while (fill-- > 0) _cell[x++] = ' ';
+			else if (_align == Talign::CENTER)
+				for (auto i = fill/2; i > 0; i--) _cell[x++] = ' ';
+			while (len-- > 0)
+				_cell[x++] = Tutf8::next(_str);
+			while (x < _width)
+				_cell[x++] = ' ';
+		}
+
+		template <int width, int align = Talign::LEFT>
+		struct Tcolumn{
+			static_assert(width > 0, "columns need a width");
+			constexpr static int WIDTH = width;
+			constexpr static int ALIGN = align;
+		};
+
+		template <class... Tcolumns>
+		struct Sum{
+			constexpr static int value = 0;
+		};
+
+		template <class First, class... Rest>
+		struct Sum<First,Rest...>{
+			constexpr static int value = First::WIDTH + Sum<Rest...>::value;
+		};
+
+		template <int col, class... Tcolumns>
+		struct TcolumnAt;
+
+		template <class First, class... Rest>
+		struct TcolumnAt<0,First,Rest...>{
+			typedef First type;
+			constexpr static int OFFSET = 0;
+		};
+
+		template <int col, class First, class... Rest>
+		struct TcolumnAt<col,First,Rest...>{
+			static_assert(col > 0 && col <= int(sizeof...(Rest)), "column index out of range");
+			typedef typename TcolumnAt<col-1,Rest...>::type type;
+			constexpr static int OFFSET = First::WIDTH + TcolumnAt<col-1,Rest...>::OFFSET;
+		};
+
+		/**
+		 * @brief table of columns with compile time widths and offsets
+		 *
+		 * usage:
+		 *	typedef TtableLayout<Tcolumn<16>, Tcolumn<1>, Tcolumn<15,Talign::RIGHT>, Tcolumn<1>, Tcolumn<7>> Tlayout;
+		 *	Tlayout::writeCell<2>(display,row,"42.0");
+		 *
+		 * A cell only writes its own columns. As the display tracks changes per
+		 * row span, a changing cell doesn't cause other cells to be compared or resent.
+		 */
+		template <class... Tcolumns>
+		struct TtableLayout{
+			constexpr static int N_COLS = sizeof...(Tcolumns);
+			constexpr static int WIDTH = Sum<Tcolumns...>::value;
+
+			template <int col>
+			struct column{
+				constexpr static int WIDTH = TcolumnAt<col,Tcolumns...>::type::WIDTH;
+				constexpr static int ALIGN = TcolumnAt<col,Tcolumns...>::type::ALIGN;
+				constexpr static int OFFSET = TcolumnAt<col,Tcolumns...>::OFFSET;
+			};
+
+			/**
+			 * @brief write the UTF-8 _str aligned into the cell, pad with blanks or truncate
+			 */
+			template <int col, class Tdisplay>
+			static void writeCell(Tdisplay& _display, int _row, const char* _str){
+				constexpr int width = column<col>::WIDTH;
+				constexpr int align = column<col>::ALIGN;
+				constexpr int offset = column<col>::OFFSET;
+
+				char cell[width];
+				tdsLayoutCell(cell,width,align,_str);
+				for (auto i = 0; i < width; i++)
+					_display.write(_row,offset+i,cell[i]);
+			}
+		};
+
+		/**
+		 * @brief layout of TtextDisplaySpike: name, gap, value
+		 *
+		 * Own layouts for TtextDisplaySpike need NAME_COL and VALUE_COL, columns
+		 * without a role stay blank. The value column has to be right aligned as
+		 * the editors place the cursor from the right.
+		 */
+		template <int nColumns, int nameWidth = 10>
+		struct TmenuLayout : TtableLayout<Tcolumn<nameWidth>, Tcolumn<1>, Tcolumn<nColumns-nameWidth-1,Talign::RIGHT>>{
+			constexpr static int NAME_COL = 0;
+			constexpr static int VALUE_COL = 2;
+		};
+
+	}
+}
+
+#endif //UTABLELAYOUT_H
@@ -0,0 +1,40 @@
+#ifndef UTDSCONFIG_H
+#define UTDSCONFIG_H
+
+/**
+ * build options shared by several headers, define them before including any of them
+ */
+
+#ifndef SDDS_TDS_STATIC_DISPATCH
+	//call backends and editors directly instead of through virtual functions:
+	//no vtables in RAM on AVR and inlined backend calls, but no runtime polymorphism
+	//of displays (e.g. Trecorder) and a backend has to name itself, see TdispatchTo
+	#define SDDS_TDS_STATIC_DISPATCH 0
+#endif
+
+#if SDDS_TDS_STATIC_DISPATCH == 1
+	#define SDDS_TDS_VIRTUAL
+	#define SDDS_TDS_OVERRIDE
+	#define SDDS_TDS_ABSTRACT
+#else
+	#define SDDS_TDS_VIRTUAL virtual
+	#define SDDS_TDS_OVERRIDE override
+	#define SDDS_TDS_ABSTRACT = 0
+#endif
+
+#ifndef SDDS_TDS_SHARED_CORE
+	//diffing, cell layout and digit stepping as one copy with runtime dimensions and types
+	//instead of an inlined copy per display size and integer type: less flash for firmware
+	//with several displays or editors, a function call more per row and key
+	#define SDDS_TDS_SHARED_CORE 0
+#endif
+
+//functions of the core that don't depend on template parameters, see SDDS_TDS_SHARED_CORE
+//plain inline without the shared core, the compiler decides as it did before
+#if SDDS_TDS_SHARED_CORE == 1 && defined(__GNUC__)
+	#define SDDS_TDS_SHARED inline __attribute__((noinline))
+#else
+	#define SDDS_TDS_SHARED inline
+#endif
+
+#endif //UTDSCONFIG_H
@@ -0,0 +1,28 @@
+#ifndef UTDSMILLIS_H
+#define UTDSMILLIS_H
+
+#include "uTypedef.h"
+
+#if SDDS_ON_ARDUINO != 1
+	#include <chrono>
+#endif
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		/**
+		 * @brief milliseconds since start, for timestamps of keys and display contents
+		 */
+#if SDDS_ON_ARDUINO == 1
+		inline dtypes::uint32 tdsMillis(){ return millis(); }
+#else
+		inline dtypes::uint32 tdsMillis(){
+			using namespace std::chrono;
+			return static_cast<dtypes::uint32>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+		}
+#endif
+
+	}
+}
+
+#endif //UTDSMILLIS_H
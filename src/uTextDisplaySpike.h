@@ -6,26 +6,48 @@
 #include "uTypedef.h"
 #include "uSddsToString.h"
 #include "uEditors.h"
-
-template<class TdisplayType>
-class TtextDisplaySpike : Tthread{
+#include "uChildIndex.h"
+#include "uMenuObserver.h"
+#include "uTableLayout.h"
+#include "uBarGraph.h"
+
+#ifndef SDDS_TDS_ESC_TIMEOUT
+	//ms an Esc modifies the next key, see handleEscModifier
+	#define SDDS_TDS_ESC_TIMEOUT 3000
+#endif
+
+#ifndef SDDS_TDS_CHILD_INDEX_SIZE
+	//children of the current menu with O(1) access, larger menus are indexed with gaps
+	#define SDDS_TDS_CHILD_INDEX_SIZE 32
+#endif
+
+/**
+ * @tparam Tlayout columns of the menu, see TmenuLayout
+ */
+template<class TdisplayType, class Tlayout = sdds::textDisplaySpike::TmenuLayout<TdisplayType::N_COLUMNS>>
+class TtextDisplaySpike : Tthread, sdds::textDisplaySpike::TmenuObserver::Tlistener{
 	private:
 		using TeditorBase = sdds::textDisplaySpike::TeditorBase;
+		using TmenuObserver = sdds::textDisplaySpike::TmenuObserver;
 
 		constexpr static int N_LINES = TdisplayType::N_LINES;
 		constexpr static int N_COLUMNS = TdisplayType::N_COLUMNS;
 		constexpr static int LAST_COLUMN = TdisplayType::N_COLUMNS - 1;
-		constexpr static int NAME_COL_WIDTH = 10;
-		constexpr static int VAL_COL_START = 11;
-		constexpr static int VAL_COL_WIDTH = N_COLUMNS-VAL_COL_START;
+		typedef typename Tlayout::template column<Tlayout::VALUE_COL> TvalueColumn;
+		constexpr static int VAL_COL_START = TvalueColumn::OFFSET;
+		constexpr static int VAL_COL_WIDTH = TvalueColumn::WIDTH;
+		static_assert(Tlayout::WIDTH <= N_COLUMNS, "layout is wider than the display");
+		static_assert(TvalueColumn::ALIGN == sdds::textDisplaySpike::Talign::RIGHT, "editors require a right aligned value column");
 
 		constexpr static int N_VIEWS = 20;
+		constexpr static int MAX_KEYS_PER_TICK = 16;		//max. number of keys coalesced into one operation
 
 		TdisplayType* Fdisplay;
 		TmenuHandle* Froot;
 		Tevent FevReadKey;
+		dtypes::uint16 FkeyPollInterval = 10;
 
-		TobjectEvent FmenuEvent;
+		TmenuObserver* Fobserver;
 
 		sdds::textDisplaySpike::TeditorContainer FeditorContainer;
 		Tdescr* FvalueInEditor = nullptr;
@@ -35,7 +57,7 @@ class TtextDisplaySpike : Tthread{
 		class Tview{
 			public:
 				Tstruct* menu = nullptr;
-				dtypes::uint8 firstVisible = 0;		//first line of struct visible in display window
+				dtypes::uint16 firstVisible = 0;	//first line of struct visible in display window
 				dtypes::uint8 cursorY = 0;			//cursor pos in display window
 				TmenuHandle* menuHandle() { return menu->value(); }
 		};
@@ -44,6 +66,20 @@ class TtextDisplaySpike : Tthread{
 		Tview* FcurrView;
 		TmenuHandle* currMenu() { return FcurrView->menuHandle(); }
 
+		sdds::textDisplaySpike::TchildIndex<SDDS_TDS_CHILD_INDEX_SIZE> FchildIndex;
+		int childCount() { return FchildIndex.childCount(currMenu()); }
+
+		//shown while Esc modifies the next key, the modifier expires with it
+		constexpr static int ESC_MARKER_COL = VAL_COL_START > 0 ? VAL_COL_START - 1 : LAST_COLUMN;
+		sdds::textDisplaySpike::Toverlay<1,1> FescMarker;
+		bool escModifier(){ return FescMarker.visible(); }
+		void setEscModifier(bool _armed){
+			if (!_armed) return FescMarker.hide();
+			Fdisplay->showOverlay(FescMarker,Fdisplay->getCursor().y,ESC_MARKER_COL,SDDS_TDS_ESC_TIMEOUT);
+		}
+
+		Tdescr* FnameInRow[N_LINES] = {};	//item whose name is on the display, nullptr after clear
+
 		dtypes::string FworkStr;
 
 		Tview* findView(Tstruct* _menu){
@@ -64,10 +100,16 @@ class TtextDisplaySpike : Tthread{
 		
 		template <class Tcursor>
 		void setCursor(Tcursor& _cursor){
+			escModifierFollowsRow(_cursor.y);
 			FcurrView->cursorY = _cursor.y;
 			Fdisplay->setCursor(_cursor);
 		}
 
+		//the marker belongs to the row Esc has been pressed in, leaving it drops the modifier
+		void escModifierFollowsRow(int _row){
+			if (escModifier() && _row != Fdisplay->getCursor().y) setEscModifier(false);
+		}
+
 		void setCursorX(int _x){
 			auto c = Fdisplay->getCursor();
 			c.x = _x;
@@ -79,37 +121,28 @@ class TtextDisplaySpike : Tthread{
 		 * Helper functions for columns
 		******************************************/
 
+		/**
+		 * @brief names only change with the item in the row, so they are skipped otherwise
+		 */
 		void nameColumnToDisplay(int _dispRow, Tdescr* d){
-			const char* name = d->name();
-			int colIdx = 0;
-			while (*name != '\0'){
-				Fdisplay->write(_dispRow,colIdx,*name++);
-				if (colIdx++ >= NAME_COL_WIDTH-1) break;
-			}
-			while (colIdx <= NAME_COL_WIDTH-1)
-				Fdisplay->write(_dispRow,colIdx++,' ');
+			if (FnameInRow[_dispRow] == d) return;
+			FnameInRow[_dispRow] = d;
+			Tlayout::template writeCell<Tlayout::NAME_COL>(*Fdisplay,_dispRow,d->name());
 		}
 
 		void valueColumnToDisplay(int _dispRow, const char* _valStr){
-			int fill = VAL_COL_WIDTH - strlen(_valStr);
-			int colIdx = VAL_COL_START;
-			if (fill > 0){
-				while (fill-- > 0)
-					Fdisplay->write(_dispRow, colIdx++, ' ');
-			}
-			else{
-				while (fill++ < 0)
-					_valStr++;
-			}
-
-			while (*_valStr != '\0')
-				if (!Fdisplay->write(_dispRow,colIdx++,*_valStr++)) return;
-
+			Tlayout::template writeCell<Tlayout::VALUE_COL>(*Fdisplay,_dispRow,_valStr);
 		}
 
 		void valueColumnToDisplay(int _dispRow, Tdescr* _d){
-			sdds::to_string(FworkStr,_d);
-			valueColumnToDisplay(_dispRow,FworkStr.c_str());
+			auto options = Fobserver->options(_d);
+			dtypes::float32 value;
+			if (options && options->barGraph && sdds::textDisplaySpike::numericValue(_d,value)){
+				auto fraction = (value - options->min) / (options->max - options->min);
+				sdds::textDisplaySpike::barGraphToDisplay(*Fdisplay,_dispRow,VAL_COL_START,VAL_COL_WIDTH,fraction);
+				return;
+			}
+			valueColumnToDisplay(_dispRow,Fobserver->format(_d,FcurrView->menu));
 		}
 
 		/**
@@ -121,9 +154,14 @@ class TtextDisplaySpike : Tthread{
 		 * @param _clear clears the display before update
 		 */
 		void displayMenu(bool _clear = true){
-			if (_clear) 
+			FchildIndex.checkStructure(currMenu());
+			Fdisplay->beginFrame();
+			if (_clear){
 				Fdisplay->clear();
-			auto it = currMenu()->iterator(FcurrView->firstVisible);
+				for (auto row = 0; row < N_LINES; row++)
+					FnameInRow[row] = nullptr;
+			}
+			auto it = FchildIndex.iterator(currMenu(),FcurrView->firstVisible);
 			for (int row = 0; row < N_LINES; row++){
 				if (!it.hasCurrent()) break;
 				Tdescr* d = it.current();
@@ -134,23 +172,38 @@ class TtextDisplaySpike : Tthread{
 				it.jumpToNext();
 			}
 			auto cursor = Fdisplay->getCursor();
+			escModifierFollowsRow(FcurrView->cursorY);
 			cursor.y = FcurrView->cursorY;
 			Fdisplay->setCursor(cursor);
+			Fdisplay->commitFrame();
 		}
 
 		Tdescr* itemUnderCursor(){
 			auto cursor = Fdisplay->getCursor();
-			return currMenu()->get(cursor.y+FcurrView->firstVisible);
+			return FchildIndex.get(currMenu(),cursor.y+FcurrView->firstVisible);
+		}
+
+		/**
+		 * @brief only observe the items in the display window
+		 * 
+		 * Changes of items scrolled out of view don't wake us up.
+		 */
+		void updateObservedRange(){
+			int first = FcurrView->firstVisible;
+			Fobserver->observe(this,FcurrView->menu,first,first + N_LINES - 1);
+		}
+
+		void menuChanged() override{
+			displayMenu(false);
 		}
 
 		void enterMenu(Tstruct* _menu){
 			if (!_menu) return;
 
-			FcurrView->menuHandle()->events()->remove(&FmenuEvent);
+			setEscModifier(false);
 			FcurrView = findView(_menu);
 			FcurrView->menu = _menu;
-			FmenuEvent.setObservedRange(0,255);
-			FcurrView->menuHandle()->events()->push_first(&FmenuEvent);
+			updateObservedRange();
 			displayMenu();
 		}
 
@@ -188,6 +241,7 @@ class TtextDisplaySpike : Tthread{
 		 *
 		 * @param method Pointer to the member function of `TeditorBase` to be invoked.
 		 *               This should be a method with no arguments and no return value.
+		 * @param _repeat number of times the method is invoked before the display is updated
 		 * @return TeditorBase* Returns a pointer to the active editor if a value is 
 		 *         currently being edited; returns `nullptr` otherwise.
 		 *
@@ -202,61 +256,88 @@ class TtextDisplaySpike : Tthread{
 		 * }
 		 * ```
 		 */
-		bool handleKey(void (TeditorBase::*method)()) {
+		bool handleKey(void (TeditorBase::*method)(), int _repeat = 1) {
 			auto editor = FeditorContainer.getInstance();
 			if (!editor) return false;
-			(editor->*method)();
-			if (editor->editDone()){
-				editDone();
-				return true;
+			while (_repeat-- > 0){
+				(editor->*method)();
+				if (editor->editDone()){
+					editDone();
+					return true;
+				}
 			}
-			editor->getDisplayString(FworkStr);
-			valueColumnToDisplay(Fdisplay->getCursor().y,FworkStr.c_str());
+			valueInEditorToDisplay(editor);
 			setCursorX(editor->displayCursorPos() + VAL_COL_START);
 			return true;
 		}
 
 		/**
-		 * @brief handles a keyUp event
-		 * 
-		 * Forwards the event a type-specific editor class if one is active.
-		 * Otherwise move the cursor or scroll the view if neccessary
-		 * 
+		 * @brief write the characters the editor changed, the whole value only if it can't tell
 		 */
-		void doOnkeyUp(){
-			if (handleKey(&TeditorBase::keyUp)) return;
+		void valueInEditorToDisplay(TeditorBase* _editor){
+			auto row = Fdisplay->getCursor().y;
+			int low, high;
+			if (!_editor->takeChangedSpan(low,high)){
+				_editor->getDisplayString(FworkStr);
+				valueColumnToDisplay(row,FworkStr.c_str());
+				return;
+			}
+			constexpr int lastCol = VAL_COL_START + VAL_COL_WIDTH - 1;
+			for (auto pos = low; pos <= high && pos < VAL_COL_WIDTH; pos++)
+				Fdisplay->write(row,lastCol - pos,_editor->displayChar(pos));
+		}
 
+		/**
+		 * @brief move the cursor by _delta items and scroll the view if neccessary
+		 * 
+		 * The display is only redrawn once, no matter how far the cursor moves.
+		 */
+		void moveCursor(int _delta){
 			auto cursor = Fdisplay->getCursor();
-			if (cursor.y == 0 && FcurrView->firstVisible > 0){
-				FcurrView->firstVisible--;
+			int count = childCount();
+			int pos = FcurrView->firstVisible + cursor.y + _delta;
+			if (pos >= count) pos = count-1;
+			if (pos < 0) pos = 0;
+
+			int firstVisible = FcurrView->firstVisible;
+			if (pos < firstVisible) firstVisible = pos;
+			else if (pos >= firstVisible + N_LINES) firstVisible = pos - N_LINES + 1;
+
+			cursor.y = pos - firstVisible;
+			if (firstVisible != FcurrView->firstVisible){
+				FcurrView->firstVisible = firstVisible;
+				FcurrView->cursorY = cursor.y;
+				updateObservedRange();
 				displayMenu(false);
 				return;
 			}
-			cursor.up();
-			setCursor(cursor);			
+			setCursor(cursor);
 		}
 
 		/**
-		 * @brief handles a keyDown event
+		 * @brief handles a keyUp event
 		 * 
 		 * Forwards the event a type-specific editor class if one is active.
 		 * Otherwise move the cursor or scroll the view if neccessary
 		 * 
+		 * @param _n number of consecutive keyUp events
 		 */
-		void doOnkeyDown(){
-			if (handleKey(&TeditorBase::keyDown)) return;
-			
-			auto cursor = Fdisplay->getCursor();
-			if (cursor.y >= N_LINES - 1){
-				if (FcurrView->firstVisible + N_LINES + 1 > currMenu()->childCount()) return;
-				FcurrView->firstVisible++;
-				displayMenu(false);
-				return;
-			}
+		void doOnkeyUp(int _n = 1){
+			if (handleKey(&TeditorBase::keyUp,_n)) return;
+			moveCursor(-_n);
+		}
 
-			else if (FcurrView->firstVisible + cursor.y + 1 >= currMenu()->childCount()) return;
-			cursor.down();
-			setCursor(cursor);		
+		/**
+		 * @brief handles a keyDown event
+		 * 
+		 * Forwards the event a type-specific editor class if one is active.
+		 * Otherwise move the cursor or scroll the view if neccessary
+		 * 
+		 * @param _n number of consecutive keyDown events
+		 */
+		void doOnkeyDown(int _n = 1){
+			if (handleKey(&TeditorBase::keyDown,_n)) return;
+			moveCursor(_n);
 		}
 
 		/**
@@ -311,53 +392,115 @@ class TtextDisplaySpike : Tthread{
 
 		/**
 		 * @brief handles a keyEscape event
+		 * 
+		 * Forwards the event a type-specific editor class if one is active. 
+		 * Otherwise Esc modifies the next key within SDDS_TDS_ESC_TIMEOUT,
+		 * see handleEscModifier. A marker left of the value shows that.
 		 */
 		void doOnkeyEsc(){
 			if (handleKey(&TeditorBase::keyEsc)) return;
+			setEscModifier(!escModifier());
+		}
+
+		/**
+		 * @brief navigation in large menus
+		 * 
+		 * Esc+Up/Down move the cursor by a page, Esc+Left/Right jump to
+		 * the first/last item of the menu. The modifier applies to one key,
+		 * the rest of a run of Up/Down moves line by line as without Esc.
+		 * 
+		 * @return true if the key has been consumed
+		 */
+		bool handleEscModifier(int _key, int _count){
+			if (!escModifier() || _key == TdisplayType::SDDS_TDS_KEY_ESC) return false;
+			setEscModifier(false);
+			switch (_key) {
+				case TdisplayType::SDDS_TDS_KEY_UP:
+					moveCursor(-N_LINES);
+					if (_count > 1) doOnkeyUp(_count-1);
+					return true;
+				case TdisplayType::SDDS_TDS_KEY_DOWN:
+					moveCursor(N_LINES);
+					if (_count > 1) doOnkeyDown(_count-1);
+					return true;
+				case TdisplayType::SDDS_TDS_KEY_LEFT: moveCursor(-childCount()); return true;
+				case TdisplayType::SDDS_TDS_KEY_RIGHT: moveCursor(childCount()); return true;
+			}
+			return false;
 		}
 	
-		void readKey(){
-			switch (Fdisplay->readKey()) {
-				case TdisplayType::SDDS_TDS_KEY_UP: return doOnkeyUp();
-				case TdisplayType::SDDS_TDS_KEY_DOWN: return doOnkeyDown();
+		/**
+		 * @brief dispatches _count consecutive presses of _key, editors are reached through handleKey
+		 */
+		void handleKeyRun(int _key, int _count){
+			if (handleEscModifier(_key,_count)) return;
+			switch (_key) {
+				case TdisplayType::SDDS_TDS_KEY_UP: return doOnkeyUp(_count);
+				case TdisplayType::SDDS_TDS_KEY_DOWN: return doOnkeyDown(_count);
 				case TdisplayType::SDDS_TDS_KEY_LEFT: return doOnkeyLeft();
 				case TdisplayType::SDDS_TDS_KEY_RIGHT: return doOnkeyRight();
 				case TdisplayType::SDDS_TDS_KEY_ESC: return doOnkeyEsc();
 				case TdisplayType::SDDS_TDS_KEY_ENTER: return doOnkeyEnter();
 			}
 		}
+
+		/**
+		 * @brief handles all keys pending in the display
+		 * 
+		 * Runs of UP/DOWN are handled as one operation, so five DOWNs scroll by 
+		 * five with a single redraw. All keys of a tick are shown in one frame.
+		 */
+		void readKey(){
+			int key = Fdisplay->readKey();
+			if (key == 0) return;
+			FchildIndex.checkStructure(currMenu());
+			Fdisplay->beginFrame();
+			while (key != 0){
+				int count = 1;
+				int next = Fdisplay->readKey();
+				bool coalesce = (key == TdisplayType::SDDS_TDS_KEY_UP) || (key == TdisplayType::SDDS_TDS_KEY_DOWN);
+				while (coalesce && next == key && count < MAX_KEYS_PER_TICK){
+					count++;
+					next = Fdisplay->readKey();
+				}
+				handleKeyRun(key,count);
+				key = next;
+			}
+			Fdisplay->commitFrame();
+		}
 	
 		void execute(Tevent* _ev) override{
 			if (_ev == &FevReadKey){
 				readKey();
-				FevReadKey.setTimeEvent(10);
-			} else if (_ev == FmenuEvent.event()){
-				if (FmenuEvent.getChangedItemCount() > 0)
-					displayMenu(false);
-				_ev->setTimeEvent(250);		//limit update rate to 4Hz
+				FevReadKey.setTimeEvent(FkeyPollInterval);
 			} else if (isTaskEvent(_ev)){
-				static bool init = true;
-				if (init){
-					_ev->setTimeEvent(1000);
-					init = false;
-					Fdisplay->begin();
-					return;
-				}
+				//the first screen is prepared right away and sent as soon as the display is ready
+				Fdisplay->begin();
 				FcurrView = findView(Froot);
 				enterMenu(Froot);
 			}
 		}
 
 	public:
-		TtextDisplaySpike(TmenuHandle& _root, TdisplayType& _display)
+		/**
+		 * @param _observer sessions sharing an observer share subscriptions and
+		 * formatted values, by default all sessions share one
+		 */
+		TtextDisplaySpike(TmenuHandle& _root, TdisplayType& _display, TmenuObserver& _observer = TmenuObserver::shared())
 			: FevReadKey(this)
-			, FmenuEvent(this)
 		{
+			FescMarker.write(0,0,'\xBB');		//»
+			Fobserver = &_observer;
 			Fdisplay = &_display;
 			Froot = &_root;
 			FcurrView = findView(_root);
-			FevReadKey.setTimeEvent(10);
+			FevReadKey.setTimeEvent(FkeyPollInterval);
 		}
+
+		/**
+		 * @brief time between two reads of the keys, e.g. 1 to replay recordings quickly
+		 */
+		void setKeyPollInterval(dtypes::uint16 _ms){ FkeyPollInterval = _ms; }
 };
 
 #endif //UTEXTDISPLAYSPIKE_H
@@ -0,0 +1,120 @@
+#ifndef UTEXTOVERLAY_H
+#define UTEXTOVERLAY_H
+
+#include "uMultask.h"
+#include "uCharset.h"
+
+namespace sdds{
+	namespace textDisplaySpike{
+
+		class TtextOverlay;
+
+		class ToverlayHost{
+			public:
+				virtual void overlayChanged(TtextOverlay& _overlay, int _row, int _col) = 0;
+				virtual void hideOverlay(TtextOverlay& _overlay) = 0;
+		};
+
+		template <int nRows, int nColumns, class Tbackend>
+		class TabstractTextDisplay;
+
+		/**
+		 * @brief rectangular region shown on top of the display content
+		 *
+		 * See TabstractTextDisplay::showOverlay. The storage is provided by
+		 * Toverlay, this class is what the display works with.
+		 */
+		class TtextOverlay{
+				template <int nRows, int nColumns, class Tbackend>
+				friend class TabstractTextDisplay;
+			public:
+				int width() const { return Fwidth; }
+				int height() const { return Fheight; }
+				int row() const { return Frow; }
+				int col() const { return Fcol; }
+				bool visible() const { return Fhost != nullptr; }
+
+				bool covers(int _row, int _col) const {
+					return (_row >= Frow) && (_row < Frow + Fheight) && (_col >= Fcol) && (_col < Fcol + Fwidth);
+				}
+
+				/**
+				 * @brief write a character, _row and _col are relative to the overlay
+				 */
+				void write(int _row, int _col, char _c){
+					if (_row < 0 || _row >= Fheight || _col < 0 || _col >= Fwidth) return;
+					content(_row,_col) = _c;
+					if (Fhost) Fhost->overlayChanged(*this,Frow+_row,Fcol+_col);
+				}
+
+				/**
+				 * @brief write the UTF-8 _text to a line of the overlay, the rest of the line is blanked
+				 */
+				void print(int _row, const char* _text){
+					int col = 0;
+					while (*_text != '\0' && col < Fwidth)
+						write(_row,col++,Tutf8::next(_text));
+					while (col < Fwidth)
+						write(_row,col++,' ');
+				}
+
+				void fill(char _c = ' '){
+					for (auto row = 0; row < Fheight; row++)
+						for (auto col = 0; col < Fwidth; col++)
+							write(row,col,_c);
+				}
+
+				void hide(){
+					FdismissTimer.stop();
+					if (Fhost) Fhost->hideOverlay(*this);
+				}
+
+			protected:
+				TtextOverlay(int _width, int _height, char* _content, char* _saveUnder)
+					: Fwidth(_width)
+					, Fheight(_height)
+					, Fcontent(_content)
+					, FsaveUnder(_saveUnder)
+				{
+					for (auto i = 0; i < Fwidth*Fheight; i++)
+						Fcontent[i] = ' ';
+					on(FdismissTimer){ static_cast<TtextOverlay*>(_self)->hide(); };
+				}
+
+			private:
+				int Fwidth;
+				int Fheight;
+				int Frow = 0;
+				int Fcol = 0;
+				char* Fcontent;
+				char* FsaveUnder;		//display content below the overlay where no other overlay is below
+				ToverlayHost* Fhost = nullptr;
+				Ttimer FdismissTimer;
+
+				//row and col of the display
+				char& content(int _row, int _col){ return Fcontent[_row*Fwidth + _col]; }
+				char& displayContent(int _row, int _col){ return content(_row-Frow,_col-Fcol); }
+				char& saveUnder(int _row, int _col){ return FsaveUnder[(_row-Frow)*Fwidth + _col-Fcol]; }
+		};
+
+		/**
+		 * @brief overlay with storage for its text and the save-under
+		 *
+		 * usage:
+		 *	Toverlay<1,8> saved;
+		 *	saved.print(0," saved ");
+		 *	disp.showOverlay(saved,1,6,2000);		//dismissed after 2s
+		 */
+		template <int nRows, int nColumns>
+		class Toverlay : public TtextOverlay{
+			public:
+				Toverlay() : TtextOverlay(nColumns,nRows,Fcontent,FsaveUnder){}
+			private:
+				char Fcontent[nRows*nColumns];
+				char FsaveUnder[nRows*nColumns];
+		};
+
+	}
+}
+
+#endif //UTEXTOVERLAY_H